@@ -0,0 +1,76 @@
+/*
+ * Micro-benchmark of pattern based generation and matching.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -std=c++11 bench/pattern.cpp -o pattern && ./pattern
+ *
+ * Prints ns per token of rnd.next(ptrn) with the compiled pattern cache,
+ * of constructing a pattern for each token (the behaviour without the
+ * cache) and of reusing a single pattern object, for several patterns.
+ */
+#include "../gen/testlib.h"
+#include <chrono>
+
+static const int TOKENS = 1000000;
+
+template <typename F>
+double measure(F f)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t sum = f();
+    std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now();
+    if (sum == 42)
+        std::printf(" ");
+    return std::chrono::duration<double, std::nano>(finish - start).count() / TOKENS;
+}
+
+int main(int argc, char* argv[])
+{
+    registerGen(argc, argv, 4);
+
+    const char* patterns[] = {
+        "[a-z]{5,10}",
+        "-?[1-9][0-9]{0,8}",
+        "[A-Z][a-z]{2,7}_(mike|john|[0-9]{1,3})",
+        "[a-zA-Z0-9]{100}"
+    };
+
+    std::printf("%-42s %12s %12s %12s %12s\n", "pattern", "next(ptrn)", "uncached", "object", "matches");
+    for (int k = 0; k < 4; k++)
+    {
+        std::string ptrn = patterns[k];
+        pattern p(ptrn);
+        std::vector<std::string> tokens(1000);
+        for (size_t i = 0; i < tokens.size(); i++)
+            tokens[i] = p.next(rnd);
+
+        std::printf("%-42s", ptrn.c_str());
+        std::printf(" %12.2f", measure([&ptrn]() {
+            size_t sum = 0;
+            for (int i = 0; i < TOKENS; i++)
+                sum += rnd.next(ptrn).length();
+            return sum;
+        }));
+        std::printf(" %12.2f", measure([&ptrn]() {
+            size_t sum = 0;
+            for (int i = 0; i < TOKENS; i++)
+                sum += pattern(ptrn).next(rnd).length();
+            return sum;
+        }));
+        std::printf(" %12.2f", measure([&p]() {
+            size_t sum = 0;
+            for (int i = 0; i < TOKENS; i++)
+                sum += p.next(rnd).length();
+            return sum;
+        }));
+        std::printf(" %12.2f", measure([&p, &tokens]() {
+            size_t sum = 0;
+            for (int i = 0; i < TOKENS; i++)
+                sum += p.matches(tokens[i % tokens.size()]);
+            return sum;
+        }));
+        std::printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Benchmark of prufer sequence decoding.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -std=c++11 bench/prufer.cpp -o prufer && ./prufer [max n]
+ *
+ * Prints ms of Tree::from_prufer, of the previous decoder based on a binary
+ * heap and of Tree::to_prufer for n = 10^6 up to max n (10^7 by default,
+ * 10^8 needs several GB of memory). Also checks that both decoders produce
+ * the same edges and that to_prufer gives the sequence back.
+ */
+#include "../gen/tree.h"
+#include <chrono>
+#include <queue>
+
+static gen::tree::Tree heapFromPrufer(const std::vector<int>& a)
+{
+    int n = a.size() + 2;
+    gen::tree::Tree res(n);
+    std::vector<int> deg(n, 1);
+    for (size_t i = 0; i < a.size(); i++)
+        deg[a[i]]++;
+    std::priority_queue<int, std::vector<int>, std::greater<int> > pq;
+    for (int i = 0; i < n; i++)
+        if (deg[i] == 1)
+            pq.push(i);
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        int u = a[i], v = pq.top();
+        pq.pop();
+        --deg[v];
+        --deg[u];
+        res.add_edge(u, v);
+        if (deg[u] == 1)
+            pq.push(u);
+    }
+    int u = -1, v = -1;
+    for (int i = 0; i < n && v == -1; i++)
+        if (deg[i] == 1)
+            (u == -1 ? u : v) = i;
+    res.add_edge(u, v);
+    return res;
+}
+
+template <typename F>
+double measure(F f)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(finish - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    registerGen(argc, argv, 4);
+    long long maxN = argc > 1 ? atoll(argv[1]) : 10000000;
+
+    std::printf("%12s %12s %12s %12s\n", "n", "linear", "heap", "to_prufer");
+    for (long long n = 1000000; n <= maxN; n *= 10)
+    {
+        std::vector<int> a(n - 2);
+        rnd.fill(a, int(n));
+
+        std::printf("%12lld", n);
+        std::vector<int> b;
+        {
+            gen::tree::Tree linear(1);
+            std::printf(" %12.1f", measure([&]() { linear = gen::tree::Tree::from_prufer(a); }));
+            {
+                gen::tree::Tree heap(1);
+                std::printf(" %12.1f", measure([&]() { heap = heapFromPrufer(a); }));
+                for (int i = 0; i < linear.edge_count(); i++)
+                    ensuref(linear.edge(i) == heap.edge(i), "decoders differ at edge %d", i);
+            }
+            std::printf(" %12.1f", measure([&]() { b = linear.to_prufer(); }));
+        }
+        ensuref(a == b, "to_prufer doesn't invert from_prufer");
+        std::printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Micro-benchmark of bounded integer sampling in random_t.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -std=c++11 bench/rng.cpp -o rng && ./rng
+ *
+ * Prints ns per value of rnd.next(), rnd.next(n), rnd.next(from, to) and
+ * rnd.fill() for several range sizes and random generator versions, the best
+ * of several runs.
+ */
+#include "../gen/testlib.h"
+#include <chrono>
+
+static const int CALLS = 10000000;
+static const int RUNS = 5;
+
+template <typename F>
+double measure(F f)
+{
+    double best = 0;
+    for (int run = 0; run < RUNS; run++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        long long sum = f();
+        std::chrono::steady_clock::time_point finish = std::chrono::steady_clock::now();
+        if (sum == 42)
+            std::printf(" ");
+        double elapsed = std::chrono::duration<double, std::nano>(finish - start).count() / CALLS;
+        if (run == 0 || elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    registerGen(argc, argv, 1);
+
+    const int versions[] = {1, 2, 3};
+    const int intRanges[] = {2, 26, 1000, 1000003, 1500000000};
+    const long long longRanges[] = {1000, 1000000000000LL, 6000000000000000000LL};
+
+    std::printf("%-30s %10s %10s %10s\n", "call", "v1", "v2", "v3");
+    std::printf("%-30s", "next()");
+    for (int v = 0; v < 3; v++)
+    {
+        random_t::version = versions[v];
+        random_t::engine = versions[v] < 2 ? random_t::lcg48 : random_t::xoshiro256ss;
+        std::printf(" %10.2f", measure([]() {
+            double sum = 0;
+            for (int i = 0; i < CALLS; i++)
+                sum += rnd.next();
+            return (long long)(sum);
+        }));
+    }
+    std::printf("\n");
+    for (int r = 0; r < 5; r++)
+    {
+        int n = intRanges[r];
+        std::printf("%-30s", format("next(%d)", n).c_str());
+        for (int v = 0; v < 3; v++)
+        {
+            random_t::version = versions[v];
+            random_t::engine = versions[v] < 2 ? random_t::lcg48 : random_t::xoshiro256ss;
+            std::printf(" %10.2f", measure([n]() {
+                long long sum = 0;
+                for (int i = 0; i < CALLS; i++)
+                    sum += rnd.next(n);
+                return sum;
+            }));
+        }
+        std::printf("\n");
+    }
+    for (int r = 0; r < 5; r++)
+    {
+        int n = intRanges[r];
+        std::printf("%-30s", format("next(1, %d)", n).c_str());
+        for (int v = 0; v < 3; v++)
+        {
+            random_t::version = versions[v];
+            random_t::engine = versions[v] < 2 ? random_t::lcg48 : random_t::xoshiro256ss;
+            std::printf(" %10.2f", measure([n]() {
+                long long sum = 0;
+                for (int i = 0; i < CALLS; i++)
+                    sum += rnd.next(1, n);
+                return sum;
+            }));
+        }
+        std::printf("\n");
+    }
+    for (int r = 0; r < 3; r++)
+    {
+        long long n = longRanges[r];
+        std::printf("%-30s", format("next(%lldLL)", n).c_str());
+        for (int v = 0; v < 3; v++)
+        {
+            random_t::version = versions[v];
+            random_t::engine = versions[v] < 2 ? random_t::lcg48 : random_t::xoshiro256ss;
+            std::printf(" %10.2f", measure([n]() {
+                long long sum = 0;
+                for (int i = 0; i < CALLS; i++)
+                    sum += rnd.next(n);
+                return sum;
+            }));
+        }
+        std::printf("\n");
+    }
+
+    std::vector<int> values(CALLS);
+    for (int r = 0; r < 5; r++)
+    {
+        int n = intRanges[r];
+        std::printf("%-30s", format("fill(%d)", n).c_str());
+        for (int v = 0; v < 3; v++)
+        {
+            random_t::version = versions[v];
+            random_t::engine = versions[v] < 2 ? random_t::lcg48 : random_t::xoshiro256ss;
+            std::printf(" %10.2f", measure([n, &values]() {
+                rnd.fill(values, n);
+                return (long long)(values[CALLS - 1]);
+            }));
+        }
+        std::printf("\n");
+    }
+
+    return 0;
+}
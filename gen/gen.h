@@ -4,3 +4,4 @@
 #include "tree.h"
 #include "string.h"
 #include "seq.h"
+#include "io.h"
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "testlib.h"
+#include "tree.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+#ifndef ON_WINDOWS
+#include <unistd.h>
+#endif
+
+namespace gen {
+namespace io {
+
+// Buffered writer for large tests.
+// Numbers are formatted into the buffer directly, full buffers go to a `FILE*` by `fwrite`,
+// or straight to a file descriptor by `write(2)` without stdio locking.
+class Writer {
+ public:
+  explicit Writer(std::FILE* stream = stdout, size_t capacity = 1 << 16)
+      : file(stream), fd(-1), buffer(std::max<size_t>(capacity, 64)), used(0) {
+    std::fflush(file);
+  }
+
+  explicit Writer(int descriptor, size_t capacity = 1 << 16)
+      : file(nullptr), fd(descriptor), buffer(std::max<size_t>(capacity, 64)), used(0) {
+    std::fflush(stdout);
+  }
+
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  ~Writer() { flush(); }
+
+  Writer& write(char c) {
+    reserve(1);
+    buffer[used++] = c;
+    return *this;
+  }
+
+  Writer& write(const char* s, size_t length) {
+    if (length >= buffer.size()) {
+      flush();
+      sink(s, length);
+      return *this;
+    }
+    reserve(length);
+    std::memcpy(buffer.data() + used, s, length);
+    used += length;
+    return *this;
+  }
+
+  Writer& write(const char* s) { return write(s, std::strlen(s)); }
+  Writer& write(const std::string& s) { return write(s.data(), s.size()); }
+
+  template<typename Int>
+  typename std::enable_if<std::is_integral<Int>::value && !std::is_same<Int, char>::value &&
+                          !std::is_same<Int, bool>::value, Writer&>::type
+  write(Int value) {
+    reserve(max_int_length<Int>());
+    used = format_int(buffer.data() + used, value) - buffer.data();
+    return *this;
+  }
+
+  Writer& write(bool value) { return write(value ? '1' : '0'); }
+
+  // Fixed notation with `precision` digits after the decimal point.
+  Writer& write(double value, int precision = 6) { return write_fixed(value, precision); }
+  Writer& write(long double value, int precision = 6) { return write_fixed(value, precision); }
+
+  // Elements of `[first, last)` separated by `sep`, followed by `end`.
+  template<typename Iter>
+  Writer& write_ints(Iter first, Iter last, char sep = ' ', char end = '\n') {
+    for (Iter it = first; it != last; ++it) {
+      if (it != first) write(sep);
+      write(*it);
+    }
+    return write(end);
+  }
+
+  template<typename Int>
+  Writer& write_ints(const std::vector<Int>& a, char sep = ' ', char end = '\n') {
+    return write_ints(a.begin(), a.end(), sep, end);
+  }
+
+  // Edges of the tree, one per line, vertices are numbered from `base`.
+  template<typename Index>
+  Writer& write(const tree::BasicTree<Index>& t, int base = 1) {
+    for (int i = 0; i < t.edge_count(); ++i) {
+      std::pair<int, int> e = t.edge(i);
+      write(e.first + base).write(' ').write(e.second + base).write('\n');
+    }
+    return *this;
+  }
+
+  void flush() {
+    if (used) sink(buffer.data(), used);
+    used = 0;
+    if (file) std::fflush(file);
+  }
+
+ private:
+  void reserve(size_t length) {
+    if (used + length > buffer.size()) {
+      sink(buffer.data(), used);
+      used = 0;
+    }
+  }
+
+  void sink(const char* s, size_t length) {
+    if (file) {
+      ensuref(std::fwrite(s, 1, length, file) == length, "Writer failed: can't write to the file");
+      return;
+    }
+    while (length > 0) {
+#ifdef ON_WINDOWS
+      int written = _write(fd, s, static_cast<unsigned>(std::min(length, size_t(1) << 30)));
+#else
+      ssize_t written = ::write(fd, s, length);
+      if (written < 0 && errno == EINTR) continue;
+#endif
+      ensuref(written > 0, "Writer failed: can't write to the file descriptor");
+      s += written;
+      length -= static_cast<size_t>(written);
+    }
+  }
+
+  template<typename Float>
+  Writer& write_fixed(Float value, int precision) {
+    reserve(32);
+#if defined(__cpp_lib_to_chars)
+    auto result = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value,
+                                std::chars_format::fixed, precision);
+    if (result.ec == std::errc()) {
+      used = result.ptr - buffer.data();
+      return *this;
+    }
+#endif
+    // `long double` prints the same digits for a `double`, and may need more than 512 of them.
+    char temp[512];
+    int length = std::snprintf(temp, sizeof(temp), "%.*Lf", precision, static_cast<long double>(value));
+    ensuref(length >= 0, "Writer::write failed: can't format the value");
+    if (length < static_cast<int>(sizeof(temp))) return write(temp, length);
+    std::string long_temp(length + 1, '\0');
+    std::snprintf(&long_temp[0], long_temp.size(), "%.*Lf", precision, static_cast<long double>(value));
+    return write(long_temp.data(), length);
+  }
+
+  // Digits and sign of the longest value, also `__int128` in GNU modes.
+  template<typename Int>
+  static constexpr size_t max_int_length() { return std::numeric_limits<Int>::digits10 + 2; }
+
+  template<typename Int>
+  static char* format_int(char* out, Int value) {
+#if __cplusplus >= 201703L
+    if constexpr (sizeof(Int) <= sizeof(long long)) {
+      return std::to_chars(out, out + max_int_length<Int>(), value).ptr;
+    }
+#endif
+    typedef typename std::make_unsigned<Int>::type Unsigned;
+    Unsigned x = static_cast<Unsigned>(value);
+    if (value < 0) {
+      *out++ = '-';
+      x = Unsigned(0) - x;
+    }
+    char digits[max_int_length<Int>()];
+    int length = 0;
+    do {
+      digits[length++] = static_cast<char>('0' + x % 10);
+      x /= 10;
+    } while (x);
+    while (length) *out++ = digits[--length];
+    return out;
+  }
+
+  std::FILE* file;
+  int fd;
+  std::vector<char> buffer;
+  size_t used;
+};
+
+}
+}
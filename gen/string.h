@@ -11,9 +11,33 @@ namespace str {
 
 // random
 std::string random(int n, int c) {
+  std::string s(n, 'a');
+  int buffer[1024];
+  for (int i = 0; i < n; i += 1024) {
+    int m = std::min(n - i, 1024);
+    rnd.fill(buffer, buffer + m, 0, c - 1);
+    for (int j = 0; j < m; ++j) s[i + j] = 'a' + buffer[j];
+  }
+  return s;
+}
+
+// random, the $i$-th character depends only on `key` and $first + i$,
+// so any slice of a long string can be generated independently.
+std::string random(int n, int c, unsigned long long key, long long first = 0) {
   std::string s(n, 'a');
   for (int i = 0; i < n; ++i) {
-    s[i] = 'a' + rnd.next(0, c - 1);
+    s[i] = 'a' + random_t::at(key, first + i, c);
+  }
+  return s;
+}
+
+// random, the $i$-th lowercase letter has probability proportional to `weights[i]`
+std::string random(int n, const std::vector<double>& weights) {
+  ensuref(weights.size() <= 26, "random failed: at most 26 weights");
+  alias_table table(weights);
+  std::string s(n, 'a');
+  for (int i = 0; i < n; ++i) {
+    s[i] = 'a' + rnd.next(table);
   }
   return s;
 }
@@ -56,7 +80,7 @@ std::string fibonacci(int n) {
 // a -> ab, b -> ac, c -> a
 std::string tribonacci(int n) {
   auto letters = gen::util::random_subset(26, 3);
-  std::string s(std::max(4, n));
+  std::string s(std::max(4, n), 'a');
   s[0] = 'a' + letters[0];
   s[1] = 'a' + letters[1];
   s[2] = 'a' + letters[0];
@@ -97,10 +121,24 @@ std::string geometric(int n, int m) {
   }
   shuffle(letters.begin(), letters.end());
   std::string s(n, 'a');
-  for (int i = 1; i <= n; ++i) {
-    int p = 0;
-    while (p < 25 && !rnd.next(0, m - 1)) ++p;
-    s[i - 1] = letters[p];
+  if (random_t::version < 2) {
+    for (int i = 1; i <= n; ++i) {
+      int p = 0;
+      while (p < 25 && !rnd.next(0, m - 1)) ++p;
+      s[i - 1] = letters[p];
+    }
+    return s;
+  }
+  std::vector<double> weights(26);
+  double q = 1.0;
+  for (int p = 0; p < 25; ++p) {
+    weights[p] = q * (m - 1) / m;
+    q /= m;
+  }
+  weights[25] = q;
+  alias_table table(weights);
+  for (int i = 0; i < n; ++i) {
+    s[i] = letters[rnd.next(table)];
   }
   return s;
 }
@@ -111,7 +149,7 @@ std::string abacaba(int n, int c) {
   for (char i = 'a';  i<= 'z'; ++i) {
     letters.push_back(i);
   }
-  shuffle(letters.begin(), letters.end());
+  partial_shuffle(letters.begin(), letters.begin() + std::min(c + 1, 26), letters.end());
   std::string s(n, 'a');
   for (int i = 1; i <= n; ++i) {
     s[i - 1] = letters[std::min(__builtin_ctz(i), c)];
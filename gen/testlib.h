@@ -63,6 +63,22 @@
  */
 
 const char* latestFeatures[] = {
+                          "Added shuffle_parallel(begin, end, f) which also transforms each element while it is moved",
+                          "Added InStream::readInts/readLongs to read arrays of integers, they parse mapped input without building tokens",
+                          "Large regular input files (including redirected stdin) are memory-mapped, tokens are scanned right over the mapped bytes",
+                          "join() formats integers, floating point values and strings without std::stringstream",
+                          "format(), quitf() and rnd.next(format, ...) use vsnprintf without the 16MB static buffer, they are reentrant now",
+                          "Patterns are compiled into a flat program with bitmask char sets, matching and generation are linear",
+                          "Patterns given as strings to rnd.next(ptrn) and InStream reads are compiled once and cached",
+                          "Added random_t::normal(), exponential(), pareto(), zipf(), geometric(), binomial() and poisson()",
+                          "Added alias_table, use rnd.next(table) to sample a weighted distribution in O(1)",
+                          "Added partial_shuffle(begin, middle, end) to shuffle only a prefix of the range",
+                          "Added shuffle_parallel(begin, end), a parallel shuffle which doesn't depend on the number of threads",
+                          "Use random_t::at(key, index) for counter-based random access values, random_t::philox engine",
+                          "Use rnd.split() and random_t::stream(index) to get independent generators for parallel work",
+                          "Random generator version 4: random_t::wnext() takes a single draw for any type",
+                          "Random generator version 3: division-free bounded sampling in random_t::next(n) and next(from, to)",
+                          "Use registerGen(argc, argv, 2) to switch random_t to the xoshiro256** engine, PCG64 and wyrand engines are also available",
                           "Supported --testOverviewLogFileName for validator: bounds hits + features",
                           "Fixed UB (sequence points) in random_t",
                           "POINTS_EXIT_CODE returned back to 7 (instead of 0)",
@@ -138,12 +154,34 @@ const char* latestFeatures[] = {
 #include <set>
 #include <cmath>
 #include <sstream>
+#include <iterator>
 #include <fstream>
 #include <cstring>
 #include <limits>
 #include <stdarg.h>
 #include <fcntl.h>
 
+#if __cplusplus >= 201103L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201103L)
+#   define __TESTLIB_CPP11
+#   include <atomic>
+/* MinGW with the win32 thread model and other libstdc++ builds without gthreads lack std::thread. */
+#   if !defined(__GLIBCXX__) || defined(_GLIBCXX_HAS_GTHREADS)
+#       define __TESTLIB_THREADS
+#       include <thread>
+#       include <system_error>
+#   endif
+#endif
+
+#if __cplusplus >= 201703L
+#   include <charconv>
+#endif
+
+#if defined(__AVX2__)
+#   include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#   include <emmintrin.h>
+#endif
+
 #if ( _WIN32 || __WIN32__ || _WIN64 || __WIN64__ )
 #   if !defined(_MSC_VER) || _MSC_VER>1400
 #       define NOMINMAX 1
@@ -158,6 +196,13 @@ const char* latestFeatures[] = {
 #   define WORD unsigned short
 #endif
 
+#if !defined(ON_WINDOWS) && (defined(__unix__) || defined(__APPLE__))
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#   define __TESTLIB_MMAP
+#endif
+
 #ifndef LLONG_MIN
 #define LLONG_MIN   (-9223372036854775807LL - 1)
 #endif
@@ -246,24 +291,47 @@ const char* latestFeatures[] = {
 #   define NORETURN
 #endif
                    
-static char __testlib_format_buffer[16777216];
-static int __testlib_format_buffer_usage_count = 0;
+#ifndef va_copy
+#   ifdef __va_copy
+#       define va_copy(dest, src) __va_copy(dest, src)
+#   else
+#       define va_copy(dest, src) ((dest) = (src))
+#   endif
+#endif
 
 #define FMT_TO_RESULT(fmt, cstr, result)  std::string result;                              \
-            if (__testlib_format_buffer_usage_count != 0)                                  \
-                __testlib_fail("FMT_TO_RESULT::__testlib_format_buffer_usage_count != 0"); \
-            __testlib_format_buffer_usage_count++;                                         \
             va_list ap;                                                                    \
             va_start(ap, fmt);                                                             \
-            std::vsprintf(__testlib_format_buffer, cstr, ap);                              \
+            result = __testlib_vformat(cstr, ap);                                          \
             va_end(ap);                                                                    \
-            result = std::string(__testlib_format_buffer);                                 \
-            __testlib_format_buffer_usage_count--;                                         \
 
 const long long __TESTLIB_LONGLONG_MAX = 9223372036854775807LL;
 
 NORETURN static void __testlib_fail(const std::string& message);
 
+/*
+ * Formats the arguments like vsprintf, the result may have any length.
+ * Short results are formatted into a stack buffer, longer ones by the second
+ * vsnprintf call right into the result, so it is reentrant and thread-safe.
+ */
+static std::string __testlib_vformat(const char* cstr, va_list ap)
+{
+    char buffer[1024];
+    va_list copy;
+    va_copy(copy, ap);
+    int length = vsnprintf(buffer, sizeof(buffer), cstr, copy);
+    va_end(copy);
+    if (length < 0)
+        __testlib_fail("format: encoding error in vsnprintf");
+    if (size_t(length) < sizeof(buffer))
+        return std::string(buffer, size_t(length));
+
+    std::string result(size_t(length) + 1, '\0');
+    vsnprintf(&result[0], result.size(), cstr, ap);
+    result.resize(size_t(length));
+    return result;
+}
+
 template<typename T>
 static inline T __testlib_abs(const T& x)
 {
@@ -463,6 +531,7 @@ static void __testlib_set_binary(std::FILE* file)
  * Simpler way to read token and check it for pattern matching is "inf.readToken("[a-z]+")".
  */
 class random_t;
+class alias_table;
 
 class pattern
 {
@@ -476,43 +545,721 @@ public:
     /* Returns source string of the pattern. */
     std::string src() const;
 private:
-    bool matches(const std::string& s, size_t pos) const;
+    /*
+     * The pattern is compiled into a flat program, one instruction per part
+     * of the pattern: a char set repeated from..to times (none if to is 0),
+     * then a jump to one of branches[first..last-1], or the end of the
+     * pattern if there are no branches. Matching is greedy, alternatives are
+     * tried in order, so each instruction is visited at most once per branch.
+     */
+    struct instruction
+    {
+        unsigned long long mask[4];
+        std::vector<char> chars;
+        int from;
+        int to;
+        int first;
+        int last;
+    };
+
+    int compile(std::string s);
+    bool matches(const std::string& s, int pc, size_t pos) const;
 
     std::string s;
-    std::vector<pattern> children;
-    std::vector<char> chars;
-    int from;
-    int to;
+    std::vector<instruction> program;
+    std::vector<int> branches;
+};
+
+/* Compiled pattern for given source string, see the definition below. */
+static const pattern& __testlib_compiledPattern(const std::string& ptrn);
+
+/* Returns high 64 bits of the 128-bit product a * b, low 64 bits are stored into lo. */
+static inline unsigned long long __testlib_mul128(unsigned long long a, unsigned long long b, unsigned long long& lo)
+{
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 __testlib_uint128;
+    __testlib_uint128 product = __testlib_uint128(a) * b;
+    lo = (unsigned long long)(product);
+    return (unsigned long long)(product >> 64);
+#else
+    unsigned long long aLo = a & 0xFFFFFFFFULL, aHi = a >> 32;
+    unsigned long long bLo = b & 0xFFFFFFFFULL, bHi = b >> 32;
+    unsigned long long ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+    unsigned long long middle = (ll >> 32) + (lh & 0xFFFFFFFFULL) + (hl & 0xFFFFFFFFULL);
+    lo = (middle << 32) | (ll & 0xFFFFFFFFULL);
+    return hh + (lh >> 32) + (hl >> 32) + (middle >> 32);
+#endif
+}
+
+static inline unsigned long long __testlib_rotl64(unsigned long long x, int k)
+{
+    return (x << k) | (x >> ((64 - k) & 63));
+}
+
+/* SplitMix64 step, used to expand a single seed into engine state. */
+static inline unsigned long long __testlib_splitmix64(unsigned long long& x)
+{
+    unsigned long long z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline unsigned long long __testlib_xoshiro256ss(unsigned long long* state)
+{
+    unsigned long long result = __testlib_rotl64(state[1] * 5, 7) * 9;
+    unsigned long long t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = __testlib_rotl64(state[3], 45);
+    return result;
+}
+
+/*
+ * 128-bit state is state[1]:state[0], increment is state[3]:state[2]. The lowest
+ * bit of the increment is forced to 1, the period is 2^128 for odd increments only.
+ */
+static inline unsigned long long __testlib_pcg64(unsigned long long* state)
+{
+    const unsigned long long multLo = 0x4385DF649FCCF645ULL, multHi = 0x2360ED051FC65DA4ULL;
+    const unsigned long long incLo = state[2] | 1;
+    unsigned long long lo;
+    unsigned long long hi = __testlib_mul128(state[0], multLo, lo);
+    hi += state[1] * multLo + state[0] * multHi;
+    lo += incLo;
+    hi += state[3] + (lo < incLo ? 1 : 0);
+    state[0] = lo;
+    state[1] = hi;
+    unsigned long long x = hi ^ lo;
+    int rot = int(hi >> 58);
+    return (x >> rot) | (x << ((64 - rot) & 63));
+}
+
+static inline unsigned long long __testlib_wyrand(unsigned long long* state)
+{
+    state[0] += 0xA0761D6478BD642FULL;
+    unsigned long long lo;
+    unsigned long long hi = __testlib_mul128(state[0], state[0] ^ 0xE7037ED1A0B428DBULL, lo);
+    return hi ^ lo;
+}
+
+/* Philox4x32-10 by J. Salmon et al., returns the first half of the block for given counter and key. */
+static inline unsigned long long __testlib_philox(unsigned long long key, unsigned long long counterLo, unsigned long long counterHi)
+{
+    unsigned int c0 = (unsigned int)(counterLo), c1 = (unsigned int)(counterLo >> 32);
+    unsigned int c2 = (unsigned int)(counterHi), c3 = (unsigned int)(counterHi >> 32);
+    unsigned int k0 = (unsigned int)(key), k1 = (unsigned int)(key >> 32);
+    for (int round = 0; round < 10; round++)
+    {
+        unsigned long long p0 = 0xD2511F53ULL * c0;
+        unsigned long long p1 = 0xCD9E8D57ULL * c2;
+        c0 = (unsigned int)(p1 >> 32) ^ c1 ^ k0;
+        c2 = (unsigned int)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (unsigned int)(p1);
+        c3 = (unsigned int)(p0);
+        k0 += 0x9E3779B9U;
+        k1 += 0xBB67AE85U;
+    }
+    return ((unsigned long long)(c1) << 32) | c0;
+}
+
+/*
+ * Replaces each word x of the block by (x >> 32) * range, range <= 2^32.
+ * All the paths compute exactly the same values. Used by random generator version 2.
+ */
+static inline void __testlib_mulHigh32(unsigned long long* words, size_t count, unsigned long long range)
+{
+    size_t i = 0;
+    if (range == (1ULL << 32))
+    {
+        for (; i < count; i++)
+            words[i] &= 0xFFFFFFFF00000000ULL;
+        return;
+    }
+#if defined(__AVX2__)
+    const __m256i r = _mm256_set1_epi64x((long long)(range));
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(words + i));
+        _mm256_storeu_si256((__m256i*)(words + i), _mm256_mul_epu32(_mm256_srli_epi64(x, 32), r));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i r = _mm_set1_epi64x((long long)(range));
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(words + i));
+        _mm_storeu_si128((__m128i*)(words + i), _mm_mul_epu32(_mm_srli_epi64(x, 32), r));
+    }
+#endif
+    for (; i < count; i++)
+        words[i] = (words[i] >> 32) * range;
+}
+
+/*
+ * Replaces each word x of the block by the high 64 bits of 128-bit product
+ * x * range, and stores the low 64 bits into lows, range <= 2^32.
+ * All the paths compute exactly the same values.
+ */
+static inline void __testlib_mulWide32(unsigned long long* words, unsigned long long* lows, size_t count, unsigned long long range)
+{
+    size_t i = 0;
+    if (range == (1ULL << 32))
+    {
+        for (; i < count; i++)
+            lows[i] = words[i] << 32, words[i] >>= 32;
+        return;
+    }
+    // x * range = (high(x) * range + (low(x) * range >> 32)) * 2^32 + low(low(x) * range), no overflows.
+#if defined(__AVX2__)
+    const __m256i r = _mm256_set1_epi64x((long long)(range));
+    const __m256i lowMask = _mm256_set1_epi64x(0xFFFFFFFFLL);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(words + i));
+        __m256i lowProduct = _mm256_mul_epu32(x, r);
+        __m256i middle = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), r), _mm256_srli_epi64(lowProduct, 32));
+        _mm256_storeu_si256((__m256i*)(words + i), _mm256_srli_epi64(middle, 32));
+        _mm256_storeu_si256((__m256i*)(lows + i), _mm256_or_si256(_mm256_slli_epi64(middle, 32), _mm256_and_si256(lowProduct, lowMask)));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    const __m128i r = _mm_set1_epi64x((long long)(range));
+    const __m128i lowMask = _mm_set1_epi64x(0xFFFFFFFFLL);
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(words + i));
+        __m128i lowProduct = _mm_mul_epu32(x, r);
+        __m128i middle = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), r), _mm_srli_epi64(lowProduct, 32));
+        _mm_storeu_si128((__m128i*)(words + i), _mm_srli_epi64(middle, 32));
+        _mm_storeu_si128((__m128i*)(lows + i), _mm_or_si128(_mm_slli_epi64(middle, 32), _mm_and_si128(lowProduct, lowMask)));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        unsigned long long lowProduct = (words[i] & 0xFFFFFFFFULL) * range;
+        unsigned long long middle = (words[i] >> 32) * range + (lowProduct >> 32);
+        words[i] = middle >> 32;
+        lows[i] = (middle << 32) | (lowProduct & 0xFFFFFFFFULL);
+    }
+}
+
+/*
+ * Ziggurat layers of equal area for the unnormalized density f(x) = exp(-x^2/2) or
+ * f(x) = exp(-x), see G. Marsaglia, W. W. Tsang, "The Ziggurat Method for Generating
+ * Random Variables". Layer i covers [0, x[i]) x [f[i], f[i + 1]), layer 0 is the base
+ * strip with the tail beyond x[1] = r, x[0] = area / f(r), x[256] = 0 and f[i] is the
+ * density at x[i]. The tables are constants, so layer boundaries don't depend on the
+ * platform math library.
+ */
+static const double __testlib_zigguratNormalX[257] = {
+    3.91075795953709, 3.6541528853610088, 3.4492782985609645, 3.3202447338391661,
+    3.2245750520470291, 3.14788928951715, 3.083526132001233, 3.0278377917686354,
+    2.9786032798808448, 2.9343668672078542, 2.8941210536123481, 2.8571387308721325,
+    2.8228773968253251, 2.7909211740007858, 2.7609440052788226, 2.7326853590428271,
+    2.7059336561218581, 2.6805146432845222, 2.6562830375755024, 2.6331163936303246,
+    2.6109105184875485, 2.5895759867069952, 2.5690354526805366, 2.5492215503234608,
+    2.5300752321585169, 2.5115444416253423, 2.4935830412696807, 2.4761499396691433,
+    2.4592083743333113, 2.4427253181989568, 2.426670984935726, 2.4110184138996855,
+    2.3957431197804806, 2.380822795170626, 2.3662370567158186, 2.35196722737766,
+    2.3379961487950314, 2.324308018869623, 2.31088825059985, 2.2977233489013296,
+    2.2848008027229461, 2.2721089902268239, 2.2596370951722178, 2.2473750329458078,
+    2.235313384928328, 2.2234433400909057, 2.2117566428825444, 2.200245546609648,
+    2.1889027716247207, 2.1777214677386416, 2.166695180352646, 2.1558178198750633,
+    2.1450836340462036, 2.1344871828443202, 2.1240233156878157, 2.113687150684934,
+    2.1034740557131468, 2.0933796311370503, 2.0833996939965518, 2.0735302635169788,
+    2.0637675478099564, 2.0541079316488648, 2.0445479652157328, 2.0350843537278087,
+    2.025713947862033, 2.0164337349043717, 2.0072408305586849, 1.9981324713565642,
+    1.9891060076155713, 1.9801588968985984, 1.9712886979317696, 1.9624930649424619,
+    1.953769742382734, 1.9451165600067539, 1.9365314282737589, 1.9280123340507183,
+    1.9195573365912288, 1.9111645637692822, 1.9028322085484464, 1.8945585256687101,
+    1.8863418285347764, 1.8781804862909777, 1.8700729210692368, 1.8620176053976323,
+    1.8540130597581481, 1.8460578502831198, 1.8381505865807286, 1.8302899196806666,
+    1.8224745400917832, 1.8147031759641676, 1.8069745913486934, 1.7992875845475802,
+    1.79164098655001, 1.7840336595472763, 1.776464495522345, 1.7689324149090779,
+    1.7614363653167067, 1.7539753203154551, 1.746548278279493, 1.739154261283669,
+    1.7317923140507072, 1.7244615029457757, 1.7171609150155407, 1.7098896570690061,
+    1.7026468547976139, 1.6954316519322385, 1.6882432094348587, 1.6810807047228233,
+    1.6739433309237604, 1.6668302961592867, 1.6597408228557895, 1.6526741470806485,
+    1.6456295179023603, 1.6386061967731111, 1.631603456932422, 1.6246205828305684,
+    1.6176568695705342, 1.6107116223673337, 1.603784156023583, 1.5968737944202613,
+    1.5899798700216485, 1.5831017233934714, 1.5762387027333329, 1.5693901634125345,
+    1.5625554675284397, 1.5557339834665549, 1.5489250854715355, 1.5421281532263476,
+    1.5353425714388431, 1.5285677294350246, 1.5218030207582931, 1.5150478427739924,
+    1.508301596278572, 1.5015636851127065, 1.4948335157777184, 1.4881104970546544,
+    1.4813940396253757, 1.4746835556950255, 1.4679784586152309, 1.4612781625074078,
+    1.4545820818855233, 1.4478896312776697, 1.441200224845798, 1.4345132760029464,
+    1.4278281970272904, 1.4211443986723231, 1.4144612897724647, 1.4077782768433715,
+    1.4010947636762026, 1.3944101509250713, 1.3877238356868846, 1.381035211072742,
+    1.3743436657700305, 1.367648583594318, 1.3609493430301018, 1.3542453167594306,
+    1.3475358711773593, 1.3408203658931521, 1.3340981532160836, 1.3273685776246247,
+    1.3206309752177301, 1.313884673146869, 1.3071289890273539, 1.3003632303274337,
+    1.2935866937335176, 1.2867986644897864, 1.2799984157103332, 1.2731852076618437,
+    1.2663582870146883, 1.2595168860601442, 1.2526602218912979, 1.2457874955449979,
+    1.2388978911020274, 1.2319905747424451, 1.225064693752808, 1.2181193754817266,
+    1.2111537262399112, 1.2041668301405601, 1.1971577478755859, 1.1901255154228016,
+    1.1830691426787607, 1.1759876120114898, 1.1688798767268338, 1.1617448594415742,
+    1.1545814503558518, 1.1473885054167339, 1.1401648443639958, 1.132909248648337,
+    1.1256204592112944, 1.1182971741150629, 1.1109380460092495, 1.1035416794202682,
+    1.0961066278476035, 1.0886313906495142, 1.0811144096988894, 1.0735540657878717,
+    1.0659486747575067, 1.0582964833260065, 1.0505956645862071, 1.0428443131393705,
+    1.0350404398286053, 1.0271819660307513, 1.0192667174605292, 1.0112924174349784,
+    1.0032566795395914, 0.99515699962994308, 0.98699074709384627, 0.97875515528893775,
+    0.97044731105886461, 0.96206414321760525, 0.95360240987557265, 0.94505868446257113,
+    0.93642934028089686, 0.92771053339623477, 0.91889818364373499, 0.909987953490769,
+    0.90097522445517453, 0.89185507072679238, 0.88262222957891012, 0.87327106808249455,
+    0.86379554554682692, 0.85418917100156055, 0.84444495490242366, 0.83455535407951875,
+    0.82451220874528863, 0.81430667012806435, 0.80392911698266489, 0.79336905883315278,
+    0.78261502329958876, 0.77165442421673935, 0.76047340642208316, 0.74905666200958165,
+    0.73738721142583863, 0.72544614090130355, 0.71321228518202273, 0.70066184109758445,
+    0.68776789278625772, 0.67449982282743648, 0.66082257423420598, 0.64669571488438893,
+    0.63207223637502463, 0.61689698999623555, 0.60110461774394042, 0.58461676609372226,
+    0.56733825704047303, 0.54915170231302679, 0.52990972064649511, 0.50942332958593339,
+    0.48744396612175434, 0.46363433677176324, 0.43751840218666266, 0.40838913458800075,
+    0.37512133285046573, 0.33573751918045946, 0.28617459174726051, 0.21524189591327381,
+    0
+};
+
+static const double __testlib_zigguratNormalF[257] = {
+    0.0004774677645866553, 0.001260285930498598, 0.0026090727461063629, 0.0040379725933718715,
+    0.005522403299264754, 0.0070508754713921101, 0.0086165827694229171, 0.0102149714397311,
+    0.011842757857943104, 0.013497450601780807, 0.015177088307982072, 0.016880083152595839,
+    0.01860512127578335, 0.020351096230109354, 0.022117062707379922, 0.023902203305873237,
+    0.025705804008632656, 0.027527235669693315, 0.029365939758230111, 0.03122141719202369,
+    0.033093219458688698, 0.034980941461833073, 0.036884215688691151, 0.038802707404656918,
+    0.040736110656078753, 0.042684144916619378, 0.044646552251446536, 0.046623094902089664,
+    0.048613553216035145, 0.050617723861121788, 0.052635418276973649, 0.054666461325077916,
+    0.056710690106399467, 0.058767952921137984, 0.060838108349751806, 0.062921024437977854,
+    0.065016577971470438, 0.067124653828023989, 0.069245144397250269, 0.071377949059141965,
+    0.073522973714240991, 0.075680130359194964, 0.077849336702372207, 0.080030515814947509,
+    0.082223595813495684, 0.084428509570654661, 0.086645194450867782, 0.088873592068594229,
+    0.091113648066700734, 0.093365311913026619, 0.095628536713353335, 0.097903279039215627,
+    0.10018949876917202, 0.10248715894230627, 0.10479622562286706, 0.10711666777507288,
+    0.10944845714721002, 0.11179156816424558, 0.11414597782825521, 0.11651166562603701,
+    0.1188886134433457, 0.12127680548523544, 0.1236762282020514, 0.12608687022065035,
+    0.12850872228047364, 0.13094177717412817, 0.13338602969216284, 0.13584147657175735,
+    0.13830811644906432, 0.14078594981496831, 0.14327497897404712, 0.14577520800653793,
+    0.14828664273312872, 0.15080929068241017, 0.15334316106083767, 0.15588826472506456,
+    0.15844461415652022, 0.16101222343811766, 0.16359110823298295, 0.16618128576511007,
+    0.16878277480185033, 0.17139559563815562, 0.17401977008249936, 0.17665532144440665,
+    0.1793022745235304, 0.18196065560021649, 0.18463049242750454, 0.18731181422451693,
+    0.19000465167119307, 0.19270903690432881, 0.19542500351488559, 0.19815258654653811,
+    0.20089182249543133, 0.2036427493111215, 0.20640540639867933, 0.20917983462193565,
+    0.21196607630785294, 0.2147641752520085, 0.21757417672517837, 0.22039612748101159,
+    0.22323007576478959, 0.22607607132326488, 0.22893416541557748, 0.23180441082524852,
+    0.23468686187325269, 0.23758157443217368, 0.24048860594144911, 0.24340801542371199,
+    0.24633986350223877, 0.2492842124195167, 0.25224112605694377, 0.25521066995567715,
+    0.25819291133864802, 0.26118791913376371, 0.26419576399831757, 0.26721651834463184,
+    0.27025025636695998, 0.2732970540696758, 0.27635698929678126, 0.27943014176276532,
+    0.28251659308484939, 0.28561642681665811, 0.28872972848335393, 0.29185658561828098,
+    0.29499708780116257, 0.29815132669790134, 0.30131939610203412, 0.30450139197789627,
+    0.30769741250555377, 0.31090755812756371, 0.31413193159763014, 0.3173706380312224,
+    0.32062378495823013, 0.32389148237773202, 0.32717384281495859, 0.3304709813805371,
+    0.33378301583210851, 0.33711006663841281, 0.34045225704594545, 0.34380971314829134,
+    0.34718256395825148, 0.3505709414828812, 0.35397498080156925, 0.35739482014729052,
+    0.36083060099117575, 0.3642824681305496, 0.36775056978059623, 0.37123505766982134,
+    0.37473608713949141, 0.37825381724723811, 0.38178841087503135, 0.38534003484173396,
+    0.3889088600204646, 0.39249506146101076, 0.39609881851754708, 0.39972031498193167,
+    0.40335973922286888, 0.40701728433124795, 0.41069314827198322, 0.41438753404270678,
+    0.41810064983968459, 0.4218327092313533, 0.42558393133990058, 0.42935454103134152,
+    0.43314476911457406, 0.43695485254992927, 0.44078503466776991, 0.44463556539772775,
+    0.44850670150921407, 0.4523987068638825, 0.45631185268077357, 0.46024641781492348,
+    0.46420268905027884, 0.46818096140782217, 0.47218153846988326, 0.47620473272168379,
+    0.48025086591124971, 0.4843202694289116, 0.48841328470771206, 0.49253026364614866,
+    0.49667156905479631, 0.50083757512848215, 0.50502866794582879, 0.50924524599813614,
+    0.51348772074974303, 0.51775651723220062, 0.52205207467479486, 0.5263748471741867,
+    0.53072530440619392, 0.53510393238301956, 0.53951123425954461, 0.54394773119264994,
+    0.54841396325792113, 0.55291049042851992, 0.55743789362148632, 0.56199677581727792,
+    0.56658776325895177, 0.57121150673807497, 0.57586868297521054, 0.58055999610368347,
+    0.58528617926630033, 0.59004799633579197, 0.59484624377099127, 0.59968175262216772,
+    0.60455539070054953, 0.60946806492889538, 0.6144207238920768, 0.61941436060903921,
+    0.62445001555027424, 0.62952877992812828, 0.63465179929096005, 0.63982027745643899,
+    0.64503548082425188, 0.65029874311429459, 0.65561147058322466, 0.66097514778024136,
+    0.66639134391238064, 0.67186171990076637, 0.67738803622251309, 0.68297216164879138,
+    0.68861608300852706, 0.69432191613003258, 0.7000919181404901, 0.70592850133679741,
+    0.71183424888235847, 0.7178119326349014, 0.7238645334728816, 0.72999526456580244,
+    0.73620759813126668, 0.74250529634463625, 0.74889244722372672, 0.7553735065117545,
+    0.76195334684154647, 0.76863731580333483, 0.77543130498613833, 0.7823418326598619,
+    0.78937614357119856, 0.79654233042825462, 0.80384948317638949, 0.81130787431821993,
+    0.8189291916094148, 0.82672683395209423, 0.83471629299293038, 0.84291565311844108,
+    0.85134625846512368, 0.86003362120300864, 0.86900868804379316, 0.87830965581614684,
+    0.88798466076339988, 0.89809592190630405, 0.90872644006056291, 0.91999150504836025,
+    0.93206007596899021, 0.94519895345307803, 0.95987909181241593, 0.97710170128273133,
+    1
+};
+
+static const double __testlib_zigguratExponentialX[257] = {
+    8.6971174701310527, 7.6971174701310501, 6.9410336293772126, 6.4783784938325697,
+    6.1441646657724727, 5.8821443157953999, 5.6664101674540337, 5.4828906275260625,
+    5.323090505754398, 5.1814872813015, 5.0542884899813041, 4.9387770859012505,
+    4.832939741025112, 4.7352429966017411, 4.6444918854200852, 4.5597370617073514,
+    4.4802117465284219, 4.4052876934735732, 4.334443680317273, 4.2672424802773659,
+    4.2033137137351844, 4.1423408656640515, 4.0840513104082978, 4.0282085446479368,
+    3.9746060666737888, 3.9230625001354897, 3.8734176703995091, 3.8255294185223367,
+    3.7792709924116679, 3.7345288940397974, 3.6912010902374188, 3.6491955157608538,
+    3.6084288131289095, 3.568825265648337, 3.5303158891293434, 3.4928376547740596,
+    3.4563328211327602, 3.4207483572511199, 3.386035442460301, 3.3521490309001094,
+    3.319047470970748, 3.2866921715990687, 3.2550473085704499, 3.2240795652862642,
+    3.1937579032122403, 3.1640533580259729, 3.1349388580844404, 3.1063890623398245,
+    3.0783802152540902, 3.0508900166154551, 3.0238975044556766, 2.9973829495161306,
+    2.9713277599210897, 2.9457143948950457, 2.9205262865127408, 2.8957477686001418,
+    2.8713640120155364, 2.8473609656351888, 2.8237253024500353, 2.8004443702507378,
+    2.7775061464397566, 2.7548991965623446, 2.7326126361947001, 2.7106360958679288,
+    2.6889596887418037, 2.6675739807732666, 2.6464699631518092, 2.6256390267977885,
+    2.6050729387408356, 2.5847638202141408, 2.5647041263169053, 2.54488662711187,
+    2.525304390037828, 2.505950763528594, 2.4868193617402095, 2.4679040502973648,
+    2.4491989329782498, 2.4306983392644197, 2.4123968126888706, 2.3942890999214579,
+    2.3763701405361406, 2.3586350574093373, 2.3410791477030344, 2.3236978743901964,
+    2.3064868582835798, 2.2894418705322694, 2.2725588255531548, 2.2558337743672192,
+    2.239262898312909, 2.2228425031110368, 2.2065690132576639, 2.19043896672322,
+    2.1744490099377747, 2.158595893043886, 2.142876465399842, 2.1272876713173683,
+    2.1118265460190422, 2.096490211801715, 2.0812758743932251, 2.0661808194905755,
+    2.0512024094685848, 2.0363380802487696, 2.0215853383189262, 2.0069417578945186,
+    1.9924049782135766, 1.9779727009573604, 1.9636426877895483, 1.9494127580071849,
+    1.9352807862970514, 1.9212447005915281, 1.9073024800183875, 1.8934521529393082,
+    1.8796917950722112, 1.866019527692828, 1.8524335159111756, 1.83893196701888,
+    1.8255131289035198, 1.8121752885263906, 1.7989167704602909, 1.785735935484126,
+    1.7726311792313056, 1.7596009308890748, 1.7466436519460744, 1.7337578349855716,
+    1.7209420025219353, 1.7081947058780578, 1.6955145241015379, 1.6829000629175539,
+    1.6703499537164521, 1.6578628525741728, 1.6454374393037237, 1.6330724165359913,
+    1.6207665088282579, 1.6085184617988584, 1.5963270412864834, 1.5841910325326889,
+    1.5721092393862297, 1.5600804835278881, 1.5481036037145135, 1.5361774550410321,
+    1.5243009082192263, 1.5124728488721171, 1.5006921768428167, 1.4889578055167461,
+    1.4772686611561339, 1.4656236822457454, 1.4540218188487934, 1.4424620319720125,
+    1.4309432929388797, 1.4194645827699832, 1.4080248915695357, 1.3966232179170421,
+    1.385258568263122, 1.3739299563284906, 1.3626364025050868, 1.3513769332583352,
+    1.3401505805295046, 1.3289563811371166, 1.3177933761763247, 1.3066606104151741,
+    1.295557131686601, 1.2844819902750126, 1.2734342382962411, 1.2624129290696153,
+    1.2514171164808525, 1.2404458543344066, 1.2294981956938491, 1.2185731922087901,
+    1.2076698934267611, 1.1967873460884031, 1.1859245934042022, 1.1750806743109117,
+    1.1642546227056789, 1.1534454666557747, 1.1426522275816728, 1.1318739194110785,
+    1.1211095477013302, 1.110358108727411, 1.0996185885325973, 1.0888899619385468,
+    1.0781711915113723, 1.0674612264799677, 1.0567590016025514, 1.0460634359770442,
+    1.0353734317905285, 1.0246878730026172, 1.0140056239570965, 1.0033255279156967,
+    0.9926464055072759, 0.9819670530850626, 0.97128624098390326, 0.96060271166866651,
+    0.94991517776407597, 0.93922231995526229, 0.92852278474721039, 0.91781518207004431,
+    0.90709808271569026, 0.89637001558988993, 0.88562946476175153, 0.87487486629102507,
+    0.86410460481100448, 0.85331700984237335, 0.84251035181036849, 0.83168283773427321,
+    0.82083260655441181, 0.80995772405741828, 0.79905617735548717, 0.78812586886949243,
+    0.77716460975912971, 0.76617011273543467, 0.75513998418198225, 0.7440717155005081,
+    0.7329626735843654, 0.7218100903087562, 0.71061105090965504, 0.69936248110323196,
+    0.68806113277374781, 0.67670356802952258, 0.66528614139267794, 0.65380497984766495,
+    0.64225596042453637, 0.63063468493349029, 0.61893645139487607, 0.60715622162030003,
+    0.59528858429150289, 0.58332771274876949, 0.57126731653258833, 0.55910058551154063,
+    0.54682012516331058, 0.5344178812371656, 0.52188505159213505, 0.5092119824436544,
+    0.49638804551867116, 0.48340149165346186, 0.47023927508216901, 0.45688684093142024,
+    0.4433278660735524, 0.4295439402254107, 0.41551416960035636, 0.40121467889627777,
+    0.38661797794111957, 0.37169214532991723, 0.35639976025839382, 0.34069648106484912,
+    0.32452911701690945, 0.30783295467493216, 0.29052795549123039, 0.2725131854784647,
+    0.25365836338591202, 0.23379048305967473, 0.21267151063096662, 0.18995868962243184,
+    0.16512762256418728, 0.13730498094001259, 0.10483850756581878, 0.06385216381500157,
+    0
+};
+
+static const double __testlib_zigguratExponentialF[257] = {
+    0.00016706669230796337, 0.0004541343538414966, 0.00096726928232717432, 0.0015362997803015726,
+    0.0021459677437189071, 0.0027887987935740757, 0.003460264777836904, 0.004157295120833797,
+    0.0048776559835423958, 0.0056196422072054891, 0.0063819059373191834, 0.0071633531836349908,
+    0.0079630774380170435, 0.008780314985808977, 0.0096144136425022116, 0.010464810181029981,
+    0.0113310135978346, 0.012212592426255378, 0.013109164931254991, 0.014020391403181943,
+    0.014945968011691148, 0.015885621839973156, 0.016839106826039941, 0.017806200410911355,
+    0.018786700744696024, 0.01978042433800974, 0.020787204072578114, 0.021806887504283581,
+    0.02283933540638524, 0.023884420511558174, 0.024942026419731787, 0.026012046645134221,
+    0.027094383780955803, 0.028188948763978646, 0.029295660224637411, 0.030414443910466622,
+    0.031545232172893622, 0.032687963508959555, 0.033842582150874358, 0.035009037697397431,
+    0.036187284781931443, 0.037377282772959382, 0.038578995503074871, 0.039792391023374139,
+    0.04101744138041484, 0.042254122413316254, 0.043502413568888197, 0.044762297732943289,
+    0.046033761076175184, 0.047316792913181561, 0.048611385573379504, 0.049917534282706379,
+    0.051235237055126281, 0.052564494593071685, 0.05390531019604608, 0.05525768967669703,
+    0.05662164128374287, 0.057997175631200659, 0.05938430563342028, 0.06078304644547966,
+    0.062193415408541036, 0.063615431999807376, 0.065049117786753805, 0.066494496385339816,
+    0.067951593421936643, 0.069420436498728783, 0.070901055162371843, 0.072393480875708752,
+    0.073897746992364746, 0.07541388873405841, 0.076941943170480517, 0.078481949201606435,
+    0.080033947542319905, 0.081597980709237419, 0.083174093009632397, 0.084762330532368146,
+    0.086362741140756927, 0.087975374467270231, 0.089600281910032886, 0.091237516631040197,
+    0.092887133556043569, 0.094549189376055873, 0.096223742550432825, 0.097910853311492213,
+    0.099610583670637132, 0.10132299742595363, 0.1030481601712577, 0.10478613930657016,
+    0.10653700405000163, 0.10830082545103376, 0.11007767640518536, 0.11186763167005628,
+    0.11367076788274429, 0.11548716357863351, 0.11731689921155553, 0.11916005717532764,
+    0.12101672182667479, 0.12288697950954511, 0.12477091858083093, 0.12666862943751067,
+    0.1285802045452282, 0.13050573846833077, 0.13244532790138749, 0.1343990717022136,
+    0.13636707092642883, 0.13834942886358018, 0.1403462510748624, 0.14235764543247215,
+    0.14438372216063472, 0.14642459387834489, 0.14848037564386674, 0.15055118500103984,
+    0.1526371420274428, 0.15473836938446803, 0.15685499236936515, 0.15898713896931413,
+    0.16113493991759195, 0.16329852875190173, 0.16547804187493592, 0.16767361861725008,
+    0.16988540130252755, 0.17211353531531998, 0.17435816917135341, 0.17661945459049483,
+    0.17889754657247828, 0.18119260347549626, 0.18350478709776744, 0.18583426276219708,
+    0.18818119940425426, 0.19054576966319536, 0.1929281499767713, 0.19532852067956319,
+    0.19774706610509882, 0.20018397469191121, 0.20263943909370896, 0.20511365629383765,
+    0.20760682772422198, 0.21011915938898823, 0.21265086199297822, 0.21520215107537863,
+    0.21777324714870047, 0.22036437584335944, 0.22297576805812011, 0.22560766011668396,
+    0.22826029393071662, 0.23093391716962736, 0.23362878343743329, 0.23634515245705956,
+    0.23908329026244909, 0.24184346939887713, 0.24462596913189202, 0.24743107566532754,
+    0.25025908236886224, 0.2531102900156294, 0.25598500703041532, 0.25888354974901617,
+    0.26180624268936292, 0.26475341883506215, 0.26772541993204474, 0.27072259679905997,
+    0.27374530965280292, 0.2767939284485173, 0.27986883323697287, 0.28297041453878075,
+    0.28609907373707683, 0.28925522348967769, 0.29243928816189263, 0.29565170428126125,
+    0.29889292101558185, 0.30216340067569353, 0.30546361924459026, 0.30879406693456019,
+    0.31215524877417961, 0.31554768522712895, 0.31897191284495724, 0.32242848495608922,
+    0.32591797239355635, 0.32944096426413644, 0.3329980687618091, 0.33658991402867772,
+    0.34021714906678019, 0.34388044470450257, 0.34758049462163715, 0.35131801643748345,
+    0.35509375286678763, 0.35890847294875, 0.362762973354818, 0.36665807978151438,
+    0.37059464843514622, 0.37457356761590238, 0.37859575940958107, 0.38266218149601006,
+    0.38677382908413793, 0.39093173698479738, 0.39513698183329043, 0.39939068447523135,
+    0.40369401253053055, 0.40804818315203267, 0.41245446599716146, 0.41691418643300321,
+    0.42142872899761691, 0.42599954114303468, 0.43062813728845917, 0.43531610321563691,
+    0.44006510084235417, 0.44487687341454885, 0.44975325116275533, 0.45469615747461584,
+    0.45970761564213802, 0.46478975625042651, 0.46994482528396031, 0.47517519303737771,
+    0.48048336393045454, 0.48587198734188525, 0.49134386959403287, 0.49690198724154988,
+    0.50254950184134806, 0.50828977641064321, 0.51412639381474889, 0.52006317736823393,
+    0.52610421398362006, 0.53225388026304365, 0.53851687200286225, 0.54489823767244006,
+    0.55140341654064173, 0.55803828226258789, 0.56480919291240061, 0.57172304866482615,
+    0.57878735860284536, 0.58601031847726837, 0.59340090169173376, 0.60096896636523256,
+    0.60872538207962235, 0.61668218091520788, 0.6248527387036662, 0.6332519942143664,
+    0.64189671642726642, 0.65080583341457143, 0.66000084107900014, 0.66950631673192518,
+    0.67935057226476581, 0.68956649611707843, 0.70019265508278861, 0.71127476080507646,
+    0.72286765959357246, 0.73503809243142404, 0.74786862198519566, 0.76146338884989684,
+    0.77595685204011622, 0.79152763697249628, 0.80842165152300904, 0.8269932966430511,
+    0.8477855006239905, 0.87170433238120471, 0.9004699299257477, 0.93814368086217648,
+    1
+};
+
+struct __testlib_ziggurat
+{
+    const double* x;
+    const double* f;
 };
 
+static const __testlib_ziggurat __testlib_zigguratNormal = {__testlib_zigguratNormalX, __testlib_zigguratNormalF};
+static const __testlib_ziggurat __testlib_zigguratExponential = {__testlib_zigguratExponentialX, __testlib_zigguratExponentialF};
+
+/* Logarithm of the gamma function for x >= 1, the same on all platforms unlike lgamma. */
+static inline double __testlib_loggamma(double x)
+{
+    static const double a[10] = {
+        8.333333333333333e-02, -2.777777777777778e-03, 7.936507936507937e-04, -5.952380952380952e-04,
+        8.417508417508418e-04, -1.917526917526918e-03, 6.410256410256410e-03, -2.955065359477124e-02,
+        1.796443723688307e-01, -1.39243221690590e+00
+    };
+    if (x == 1.0 || x == 2.0)
+        return 0.0;
+    int shift = x < 7.0 ? int(7.0 - x) : 0;
+    double x0 = x + shift;
+    double x2 = 1.0 / (x0 * x0);
+    double result = a[9];
+    for (int k = 8; k >= 0; k--)
+        result = result * x2 + a[k];
+    result = result / x0 + 0.9189385332046727 + (x0 - 0.5) * std::log(x0) - x0;
+    for (int k = 0; k < shift; k++)
+    {
+        x0 -= 1.0;
+        result -= std::log(x0);
+    }
+    return result;
+}
+
+/* Tail of Stirling's series, log(k!) - log(sqrt(2 pi) (k + 1)^(k + 1/2) e^-(k + 1)). */
+static inline double __testlib_stirlingTail(double k)
+{
+    static const double small[10] = {
+        0.0810614667953272, 0.0413406959554092, 0.0276779256849983, 0.02079067210376509, 0.0166446911898211,
+        0.0138761288230707, 0.0118967099458917, 0.0104112652619720, 0.00925546218271273, 0.00833056343336287
+    };
+    if (k <= 9)
+        return small[int(k)];
+    double square = (k + 1) * (k + 1);
+    return (1.0 / 12 - (1.0 / 360 - 1.0 / 1260 / square) / square) / (k + 1);
+}
+
 /* 
  * Use random_t instances to generate random values. It is preffered
  * way to use randoms instead of rand() function or self-written 
  * randoms.
  *
  * Testlib defines global variable "rnd" of random_t class.
- * Use registerGen(argc, argv, 1) to setup random_t seed be command
+ * Use registerGen(argc, argv, 4) to setup random_t seed be command
  * line (to use latest random generator version).
  *
+ * Versions 0 and 1 use 48-bit linear congruential generator, they are
+ * kept to reproduce tests of old generators. Since version 2 the engine
+ * is a modern 64-bit generator (xoshiro256** by default), it can be
+ * chosen by registerGen(argc, argv, 4, random_t::pcg64) and so on.
+ * Counter-based values are available via random_t::at(key, index).
+ * Since version 3 bounded integers are sampled without divisions,
+ * since version 4 wnext() takes a single draw for any type.
+ *
+ * Non-uniform values are available as well: normal(), exponential(),
+ * pareto(), zipf(), geometric(), binomial() and poisson(). They take O(1)
+ * draws on average and don't use the distributions of the standard library,
+ * whose algorithms differ between implementations. Ziggurat tables are
+ * constants, but rare rejection and tail steps call std::exp and std::log, so
+ * they depend on the math library being correctly rounded, as mainstream
+ * ones are for these functions in practice.
+ *
  * Random generates uniformly distributed values if another strategy is
  * not specified explicitly.
  */
 class random_t
 {
+public:
+    /* Engines which produce raw random bits. */
+    enum engine_t
+    {
+        /* Java-style 48-bit LCG, used by random generator versions 0 and 1. */
+        lcg48,
+        /* xoshiro256** by D. Blackman and S. Vigna, default since version 2. */
+        xoshiro256ss,
+        /* PCG-XSL-RR 128/64 by M. O'Neill. */
+        pcg64,
+        /* wyrand by Wang Yi, the fastest one with 64-bit state. */
+        wyrand,
+        /* 
+         * Counter-based Philox4x32-10: the i-th output for key k is at(k, i),
+         * so any element of the sequence can be computed in O(1).
+         */
+        philox
+    };
+
 private:
     unsigned long long seed;
+    unsigned long long state[4];
     static const unsigned long long multiplier;
     static const unsigned long long addend;
     static const unsigned long long mask;
     static const int lim;
 
+    void seedEngine(unsigned long long value)
+    {
+        for (int i = 0; i < 4; i++)
+            state[i] = __testlib_splitmix64(value);
+        /* xoshiro256** needs a nonzero state. PCG makes its increment state[3]:state[2] odd itself. */
+        state[3] |= 1;
+    }
+
+    /* Next bits of the 48-bit LCG, bits <= 48. */
+    long long nextLcgBits(int bits)
+    {
+        seed = (seed * multiplier + addend) & mask;
+        return (long long)(seed >> (48 - bits));
+    }
+
+    /* Next 64 random bits of engine E, resolved at compile time. */
+    template <engine_t E>
+    unsigned long long nextEngineWord()
+    {
+        if (E == xoshiro256ss)
+            return __testlib_xoshiro256ss(state);
+        if (E == pcg64)
+            return __testlib_pcg64(state);
+        if (E == wyrand)
+            return __testlib_wyrand(state);
+        if (E == philox)
+            return __testlib_philox(state[0], state[1]++, 0);
+        return ((unsigned long long)(nextLcgBits(32)) << 32) ^ (unsigned long long)(nextLcgBits(32));
+    }
+
+    template <engine_t E>
+    void nextEngineWords(unsigned long long* words, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            words[i] = nextEngineWord<E>();
+    }
+
+    /* Next 64 random bits of any engine but the default one, kept out of the inlined path. */
+    unsigned long long nextOtherWord()
+    {
+        switch (random_t::engine)
+        {
+        case pcg64:
+            return nextEngineWord<pcg64>();
+        case wyrand:
+            return nextEngineWord<wyrand>();
+        case philox:
+            return nextEngineWord<philox>();
+        default:
+            return nextEngineWord<lcg48>();
+        }
+    }
+
+    /* Next 64 random bits of the engine. The default engine is checked first and inlined into every draw. */
+    unsigned long long nextWord()
+    {
+        if (random_t::engine == xoshiro256ss)
+            return nextEngineWord<xoshiro256ss>();
+        return nextOtherWord();
+    }
+
+    /* Next count words of the engine, the same as count calls of nextWord(), dispatched once per block. */
+    void nextWords(unsigned long long* words, size_t count)
+    {
+        switch (random_t::engine)
+        {
+        case xoshiro256ss:
+            nextEngineWords<xoshiro256ss>(words, count);
+            break;
+        case pcg64:
+            nextEngineWords<pcg64>(words, count);
+            break;
+        case wyrand:
+            nextEngineWords<wyrand>(words, count);
+            break;
+        case philox:
+            nextEngineWords<philox>(words, count);
+            break;
+        default:
+            nextEngineWords<lcg48>(words, count);
+        }
+    }
+
+    static const size_t FILL_BLOCK_SIZE = 256;
+
+    /* Random value in range [0, n-1] by Lemire's multiply-shift method, n > 0. */
+    unsigned long long nextBounded64(unsigned long long n)
+    {
+        unsigned long long lo;
+        unsigned long long hi = __testlib_mul128(nextWord(), n, lo);
+        if (lo < n)
+        {
+            const unsigned long long threshold = (0 - n) % n;
+            while (lo < threshold)
+                hi = __testlib_mul128(nextWord(), n, lo);
+        }
+        return hi;
+    }
+
+    /* (x^(1 - s) - 1) / (1 - s), integral of the Zipf hat function x^-s, continuous at s = 1. */
+    static double zipfIntegral(double x, double s)
+    {
+        double logX = std::log(x), t = (1 - s) * logX;
+        return (__testlib_abs(t) > 1e-8 ? ::expm1(t) / t : 1 + t * 0.5 * (1 + t / 3 * (1 + 0.25 * t))) * logX;
+    }
+
+    static double zipfIntegralInverse(double x, double s)
+    {
+        double t = x * (1 - s);
+        if (t < -1)
+            t = -1;
+        return std::exp((__testlib_abs(t) > 1e-8 ? ::log1p(t) / t : 1 - t * (0.5 - t * (1.0 / 3 - 0.25 * t))) * x);
+    }
+
+    /* Random value of the maximum of |type| + 1 uniform values in range [0, 1), by inverse CDF. */
+    double nextMaxPower(int type)
+    {
+        return std::pow(next(), 1.0 / (__testlib_abs(type) + 1));
+    }
+
     long long nextBits(int bits) 
     {
-        if (bits <= 48)
+        if (random_t::engine != lcg48)
         {
-            seed = (seed * multiplier + addend) & mask;
-            return (long long)(seed >> (48 - bits));
+            if (bits > 63)
+                __testlib_fail("random_t::nextBits(int bits): n must be less than 64");
+            return (long long)(nextWord() >> (64 - bits));
         }
+
+        if (bits <= 48)
+            return nextLcgBits(bits);
         else
         {
             if (bits > 63)
@@ -529,11 +1276,13 @@ private:
 
 public:
     static int version;
+    static engine_t engine;
 
     /* New random_t with fixed seed. */
     random_t()
         : seed(3905348978240129619LL)
     {
+        seedEngine(seed);
     }
 
     /* Sets seed by command line. */
@@ -550,29 +1299,90 @@ public:
             seed += multiplier / addend;
         }
 
+        seedEngine(seed);
         seed = seed & mask;
     }
 
     /* Sets seed by given value. */ 
     void setSeed(long long _seed)
     {
+        seedEngine((unsigned long long)(_seed));
         _seed = (_seed ^ multiplier) & mask;
         seed = _seed;
     }
 
+    /*
+     * Counter-based random 64-bit value with given index for given key. It
+     * doesn't depend on the random generator version, engine or state, so
+     * any element of a long random sequence can be computed independently.
+     */
+    static unsigned long long at(unsigned long long key, unsigned long long index)
+    {
+        return __testlib_philox(key, index, 0);
+    }
+
+    /* Counter-based random value in range [0, n-1] with given index for given key, see at(key, index). */
+    static long long at(unsigned long long key, unsigned long long index, long long n)
+    {
+        if (n <= 0)
+            __testlib_fail("random_t::at(unsigned long long key, unsigned long long index, long long n): n must be positive");
+
+        unsigned long long lo;
+        unsigned long long hi = __testlib_mul128(__testlib_philox(key, index, 0), (unsigned long long)(n), lo);
+        if (lo < (unsigned long long)(n))
+        {
+            const unsigned long long threshold = (0 - (unsigned long long)(n)) % (unsigned long long)(n);
+            for (unsigned long long attempt = 1; lo < threshold; attempt++)
+                hi = __testlib_mul128(__testlib_philox(key, index, attempt), (unsigned long long)(n), lo);
+        }
+        return (long long)(hi);
+    }
+
+    /*
+     * Returns independent generator of the stream with given index. Its output
+     * depends only on the current state of this generator and the index, and
+     * this generator is not changed. So the streams can be used from different
+     * threads, the result doesn't depend on the scheduling.
+     */
+    random_t stream(unsigned long long index) const
+    {
+        unsigned long long key = __testlib_splitmix64(index);
+        for (int i = 0; i < 4; i++)
+        {
+            unsigned long long value = state[i] ^ key;
+            key = __testlib_splitmix64(value);
+        }
+        unsigned long long value = seed ^ key;
+        key = __testlib_splitmix64(value);
+
+        random_t result(*this);
+        result.setSeed((long long)(key));
+        return result;
+    }
+
+    /* 
+     * Returns new independent generator and moves this one forward, so the
+     * next call of split() returns another generator. Use stream(index) of
+     * the result to get generators for parallel work.
+     */
+    random_t split()
+    {
+        random_t result = stream(0);
+        nextBits(32);
+        return result;
+    }
+
 #ifndef __BORLANDC__
     /* Random string value by given pattern (see pattern documentation). */
     std::string next(const std::string& ptrn)
     {
-        pattern p(ptrn);
-        return p.next(*this);
+        return __testlib_compiledPattern(ptrn).next(*this);
     }
 #else
     /* Random string value by given pattern (see pattern documentation). */
     std::string next(std::string ptrn)
     {
-        pattern p(ptrn);
-        return p.next(*this);
+        return __testlib_compiledPattern(ptrn).next(*this);
     }
 #endif
 
@@ -582,6 +1392,9 @@ public:
         if (n <= 0)
             __testlib_fail("random_t::next(int n): n must be positive");
 
+        if (random_t::version >= 3)
+            return int(nextBounded64((unsigned long long)(n)));
+
         if ((n & -n) == n)  // n is a power of 2
             return (int)((n * (long long)nextBits(31)) >> 31);
 
@@ -609,6 +1422,9 @@ public:
         if (n <= 0)
             __testlib_fail("random_t::next(long long n): n must be positive");
 
+        if (random_t::version >= 3)
+            return (long long)(nextBounded64((unsigned long long)(n)));
+
         const long long limit = __TESTLIB_LONGLONG_MAX / n * n;
         
         long long bits;
@@ -684,6 +1500,9 @@ public:
     /* Random double value in range [0, 1). */
     double next() 
     {
+        if (random_t::engine != lcg48)
+            return (double)(nextWord() >> 11) * (1.0 / 9007199254740992.0);
+
         long long left = ((long long)(nextBits(26)) << 27);
         long long right = nextBits(27);
         return (double)(left + right) / (double)(1LL << 53);
@@ -703,6 +1522,159 @@ public:
         return next(to - from) + from;
     }
 
+    /* Random index i with probability weights[i] / sum(weights), see alias_table. */
+    int next(const alias_table& table);
+
+    /*
+     * Fills range [first, last) with random values in range [0, n-1].
+     * Before version 2 the result is the same as calling next(n) for each
+     * element in order. Since version 2 it uses division-free sampling over
+     * blocks of engine output (vectorized if SSE2 or AVX2 is available),
+     * since version 3 next(n) uses the same sampling and gives the same result.
+     */
+    void fill(int* first, int* last, int n)
+    {
+        if (n <= 0)
+            __testlib_fail("random_t::fill(int* first, int* last, int n): n must be positive");
+
+        if (random_t::engine == lcg48)
+        {
+            for (; first != last; ++first)
+                *first = next(n);
+        }
+        else
+            fill(first, last, 0, n - 1);
+    }
+
+    /* Fills range [first, last) with random values in range [from, to], see fill(int*, int*, int). */
+    void fill(int* first, int* last, int from, int to)
+    {
+        if (from > to)
+            __testlib_fail("random_t::fill(int* first, int* last, int from, int to): from can't not exceed to");
+
+        if (random_t::engine == lcg48)
+        {
+            for (; first != last; ++first)
+                *first = next(from, to);
+            return;
+        }
+
+        // Lemire's method: the high half of x * range is uniform unless the low half is below threshold.
+        const unsigned long long range = (unsigned long long)((long long)(to) - from) + 1;
+        unsigned long long words[FILL_BLOCK_SIZE];
+
+        if (random_t::version == 2)
+        {
+            const unsigned long long threshold = ((1ULL << 32) - range) % range;
+            while (first != last)
+            {
+                size_t count = __testlib_min(size_t(last - first), FILL_BLOCK_SIZE);
+                nextWords(words, count);
+                __testlib_mulHigh32(words, count, range);
+                for (size_t i = 0; i < count; i++)
+                    if ((words[i] & 0xFFFFFFFFULL) >= threshold)
+                        *first++ = int((long long)(words[i] >> 32) + from);
+            }
+            return;
+        }
+
+        const unsigned long long threshold = (0 - range) % range;
+        unsigned long long lows[FILL_BLOCK_SIZE];
+        while (first != last)
+        {
+            size_t count = __testlib_min(size_t(last - first), FILL_BLOCK_SIZE);
+            nextWords(words, count);
+            __testlib_mulWide32(words, lows, count, range);
+            for (size_t i = 0; i < count; i++)
+                if (lows[i] >= threshold)
+                    *first++ = int((long long)(words[i]) + from);
+        }
+    }
+
+    /* Fills range [first, last) with random values in range [from, to], see fill(int*, int*, int). */
+    void fill(long long* first, long long* last, long long from, long long to)
+    {
+        if (from > to)
+            __testlib_fail("random_t::fill(long long* first, long long* last, long long from, long long to): from can't not exceed to");
+
+        if (random_t::engine == lcg48)
+        {
+            for (; first != last; ++first)
+                *first = next(from, to);
+            return;
+        }
+
+        // Zero range stands for the whole 64-bit range.
+        const unsigned long long range = (unsigned long long)(to) - (unsigned long long)(from) + 1;
+        const unsigned long long threshold = (0 - range) % (range == 0 ? 1 : range);
+
+        unsigned long long words[FILL_BLOCK_SIZE];
+        while (first != last)
+        {
+            size_t count = __testlib_min(size_t(last - first), FILL_BLOCK_SIZE);
+            nextWords(words, count);
+            for (size_t i = 0; i < count; i++)
+            {
+                unsigned long long lo, hi = words[i];
+                if (range != 0)
+                    hi = __testlib_mul128(words[i], range, lo);
+                if (range == 0 || lo >= threshold)
+                    *first++ = (long long)(hi + (unsigned long long)(from));
+            }
+        }
+    }
+
+    /* Fills range [first, last) with random values in range [from, to), see fill(int*, int*, int). */
+    void fill(double* first, double* last, double from, double to)
+    {
+        if (from > to)
+            __testlib_fail("random_t::fill(double* first, double* last, double from, double to): from can't not exceed to");
+
+        if (random_t::engine == lcg48)
+        {
+            for (; first != last; ++first)
+                *first = next(from, to);
+            return;
+        }
+
+        unsigned long long words[FILL_BLOCK_SIZE];
+        while (first != last)
+        {
+            size_t count = __testlib_min(size_t(last - first), FILL_BLOCK_SIZE);
+            nextWords(words, count);
+            for (size_t i = 0; i < count; i++)
+                *first++ = (to - from) * ((double)(words[i] >> 11) * (1.0 / 9007199254740992.0)) + from;
+        }
+    }
+
+    /* Fills the vector with random values in range [0, n-1]. */
+    void fill(std::vector<int>& v, int n)
+    {
+        if (!v.empty())
+            fill(&v[0], &v[0] + v.size(), n);
+    }
+
+    /* Fills the vector with random values in range [from, to]. */
+    void fill(std::vector<int>& v, int from, int to)
+    {
+        if (!v.empty())
+            fill(&v[0], &v[0] + v.size(), from, to);
+    }
+
+    /* Fills the vector with random values in range [from, to]. */
+    void fill(std::vector<long long>& v, long long from, long long to)
+    {
+        if (!v.empty())
+            fill(&v[0], &v[0] + v.size(), from, to);
+    }
+
+    /* Fills the vector with random values in range [from, to). */
+    void fill(std::vector<double>& v, double from, double to)
+    {
+        if (!v.empty())
+            fill(&v[0], &v[0] + v.size(), from, to);
+    }
+
     /* Returns random element from container. */
     template <typename Container>
     typename Container::value_type any(const Container& c)
@@ -740,11 +1712,24 @@ public:
      * (the number of "max" functions equals to "type").
      *
      * If type < 0, than "max" function replaces with "min".
+     *
+     * Since version 4 the result is computed from a single next() for any
+     * type: floor(n * next()^(1/(type+1))) has exactly the distribution of
+     * the maximum, and the minimum is its mirror. A double has 53 bits, so
+     * for n > 2^53 the maximum of |type| + 1 values of next(n) is taken.
      */
     int wnext(int n, int type)
     {
         if (n <= 0)
             __testlib_fail("random_t::wnext(int n, int type): n must be positive");
+
+        if (random_t::version >= 4)
+        {
+            if (type == 0)
+                return next(n);
+            int result = __testlib_min(int(n * nextMaxPower(type)), n - 1);
+            return type > 0 ? result : n - 1 - result;
+        }
         
         if (abs(type) < random_t::lim)
         {
@@ -776,6 +1761,25 @@ public:
     {
         if (n <= 0)
             __testlib_fail("random_t::wnext(long long n, int type): n must be positive");
+
+        if (random_t::version >= 4)
+        {
+            if (type == 0)
+                return next(n);
+            if (n <= (1LL << 53))
+            {
+                long long result = __testlib_min((long long)(double(n) * nextMaxPower(type)), n - 1);
+                return type > 0 ? result : n - 1 - result;
+            }
+
+            // Most values in [0, n) are not multiples of n / 2^53, so inversion can't reach them.
+            long long result = next(n);
+            for (int i = 0; i < +type; i++)
+                result = __testlib_max(result, next(n));
+            for (int i = 0; i < -type; i++)
+                result = __testlib_min(result, next(n));
+            return result;
+        }
         
         if (abs(type) < random_t::lim)
         {
@@ -805,6 +1809,14 @@ public:
     /* See wnext(int, int). It uses the same algorithms. */
     double wnext(int type)
     {
+        if (random_t::version >= 4)
+        {
+            if (type == 0)
+                return next();
+            double p = nextMaxPower(type);
+            return type > 0 ? p : 1 - p;
+        }
+
         if (abs(type) < random_t::lim)
         {
             double result = next();
@@ -836,6 +1848,9 @@ public:
         if (n <= 0)
             __testlib_fail("random_t::wnext(double n, int type): n must be positive");
 
+        if (random_t::version >= 4)
+            return n * wnext(type);
+
         if (abs(type) < random_t::lim)
         {
             double result = next();
@@ -944,42 +1959,320 @@ public:
     /* Returns weighted random double value in range [from, to). */
     double wnext(double from, double to, int type)
     {
-        if (from > to)
-            __testlib_fail("random_t::wnext(double from, double to, int type): from can't not exceed to");
-        return wnext(to - from, type) + from;
+        if (from > to)
+            __testlib_fail("random_t::wnext(double from, double to, int type): from can't not exceed to");
+        return wnext(to - from, type) + from;
+    }
+
+    /* Returns weighted random element from container. */
+    template <typename Container>
+    typename Container::value_type wany(const Container& c, int type)
+    {
+        size_t size = c.size();
+        if (size <= 0)
+            __testlib_fail("random_t::wany(const Container& c, int type): c.size() must be positive");
+        return *(c.begin() + wnext(size, type));
+    }
+
+    /* Returns weighted random element from iterator range. */
+    template <typename Iter>
+    typename Iter::value_type wany(const Iter& begin, const Iter& end, int type)
+    {
+        int size = int(end - begin);
+        if (size <= 0)
+            __testlib_fail("random_t::any(const Iter& begin, const Iter& end, int type): range must have positive length");
+        return *(begin + wnext(size, type));
+    }
+
+    /* Standard normal value by the Ziggurat method. */
+    double normal()
+    {
+        const __testlib_ziggurat& table = __testlib_zigguratNormal;
+        while (true)
+        {
+            unsigned long long bits = nextWord();
+            int i = int(bits & 0xFF);
+            double u = (double)(bits >> 11) * (1.0 / 4503599627370496.0) - 1.0;
+            double x = u * table.x[i];
+            if (__testlib_abs(x) < table.x[i + 1])
+                return x;
+            if (i == 0)
+            {
+                double a, b;
+                do
+                {
+                    a = -std::log(1.0 - next()) / table.x[1];
+                    b = -std::log(1.0 - next());
+                } while (b + b < a * a);
+                return u < 0 ? -(table.x[1] + a) : table.x[1] + a;
+            }
+            if (table.f[i + 1] + (table.f[i] - table.f[i + 1]) * next() < std::exp(-0.5 * x * x))
+                return x;
+        }
+    }
+
+    /* Normal value with given mean and standard deviation. */
+    double normal(double mean, double stddev)
+    {
+        if (!(stddev >= 0))
+            __testlib_fail("random_t::normal(double mean, double stddev): stddev must be non-negative");
+        return mean + stddev * normal();
+    }
+
+    /* Exponential value with given rate lambda > 0, by the Ziggurat method. */
+    double exponential(double lambda)
+    {
+        if (!(lambda > 0))
+            __testlib_fail("random_t::exponential(double lambda): lambda must be positive");
+        const __testlib_ziggurat& table = __testlib_zigguratExponential;
+        double offset = 0;
+        while (true)
+        {
+            unsigned long long bits = nextWord();
+            int i = int(bits & 0xFF);
+            double x = (double)(bits >> 11) * (1.0 / 9007199254740992.0) * table.x[i];
+            if (x < table.x[i + 1])
+                return (offset + x) / lambda;
+            if (i == 0)
+                offset += table.x[1];
+            else if (table.f[i + 1] + (table.f[i] - table.f[i + 1]) * next() < std::exp(-x))
+                return (offset + x) / lambda;
+        }
+    }
+
+    /* Power-law value in range [xm, inf) with density proportional to x^-(alpha + 1) (Pareto distribution). */
+    double pareto(double xm, double alpha)
+    {
+        if (!(xm > 0) || !(alpha > 0))
+            __testlib_fail("random_t::pareto(double xm, double alpha): xm and alpha must be positive");
+        return xm * std::exp(exponential(alpha));
+    }
+
+    /*
+     * Random value in range [1, n] with probability proportional to k^-s (Zipf distribution), s > 0.
+     * Rejection-inversion by W. Hormann and G. Derflinger. Each call also computes
+     * three integrals for n and s (a few exp/log calls), it is cheap but not free.
+     */
+    long long zipf(long long n, double s)
+    {
+        if (n <= 0)
+            __testlib_fail("random_t::zipf(long long n, double s): n must be positive");
+        if (!(s > 0))
+            __testlib_fail("random_t::zipf(long long n, double s): s must be positive");
+        double integralX1 = zipfIntegral(1.5, s) - 1.0;
+        double integralN = zipfIntegral(double(n) + 0.5, s);
+        double squeeze = 2.0 - zipfIntegralInverse(zipfIntegral(2.5, s) - std::exp(-s * std::log(2.0)), s);
+        while (true)
+        {
+            double u = integralN + next() * (integralX1 - integralN);
+            double x = zipfIntegralInverse(u, s);
+            long long k = (long long)(x + 0.5);
+            if (k < 1)
+                k = 1;
+            else if (k > n)
+                k = n;
+            if (double(k) - x <= squeeze || u >= zipfIntegral(double(k) + 0.5, s) - std::exp(-s * std::log(double(k))))
+                return k;
+        }
+    }
+
+    /* Number of failures before the first success in Bernoulli trials with success probability p. */
+    long long geometric(double p)
+    {
+        if (!(p > 0 && p <= 1))
+            __testlib_fail("random_t::geometric(double p): p must be in range (0, 1]");
+        if (p == 1)
+            return 0;
+        double result = std::floor(exponential(1.0) / -::log1p(-p));
+        return result < 9.2e18 ? (long long)(result) : __TESTLIB_LONGLONG_MAX;
+    }
+
+    /* Number of successes in n Bernoulli trials with success probability p, by BTRS of W. Hormann. */
+    long long binomial(long long n, double p)
+    {
+        if (n < 0)
+            __testlib_fail("random_t::binomial(long long n, double p): n must be non-negative");
+        if (!(p >= 0 && p <= 1))
+            __testlib_fail("random_t::binomial(long long n, double p): p must be in range [0, 1]");
+        if (p > 0.5)
+            return n - binomial(n, 1 - p);
+        if (p == 0 || n == 0)
+            return 0;
+
+        double count = double(n);
+        if (count * p < 10)
+        {
+            /* Sums of geometric gaps between successes, O(np) draws. */
+            double logq = ::log1p(-p), sum = 0;
+            long long successes = 0;
+            while (true)
+            {
+                sum += std::ceil(std::log(1.0 - next()) / logq);
+                if (sum > count)
+                    return successes;
+                successes++;
+            }
+        }
+
+        double stddev = std::sqrt(count * p * (1 - p));
+        double b = 1.15 + 2.53 * stddev;
+        double a = -0.0873 + 0.0248 * b + 0.01 * p;
+        double c = count * p + 0.5;
+        double vr = 0.92 - 4.2 / b;
+        double ratio = p / (1 - p);
+        double alpha = (2.83 + 5.1 / b) * stddev;
+        double m = std::floor((count + 1) * p);
+        while (true)
+        {
+            double u = next() - 0.5, v = next();
+            double us = 0.5 - __testlib_abs(u);
+            double k = std::floor((2 * a / us + b) * u + c);
+            if (k < 0 || k > count)
+                continue;
+            if (us >= 0.07 && v <= vr)
+                return (long long)(k);
+            v = std::log(v * alpha / (a / (us * us) + b));
+            double bound = (m + 0.5) * std::log((m + 1) / (ratio * (count - m + 1)))
+                         + (count + 1) * std::log((count - m + 1) / (count - k + 1))
+                         + (k + 0.5) * std::log(ratio * (count - k + 1) / (k + 1))
+                         + __testlib_stirlingTail(m) + __testlib_stirlingTail(count - m)
+                         - __testlib_stirlingTail(k) - __testlib_stirlingTail(count - k);
+            if (v <= bound)
+                return (long long)(k);
+        }
+    }
+
+    /* Poisson value with given mean, by PTRS of W. Hormann. */
+    long long poisson(double mean)
+    {
+        if (!(mean >= 0 && mean < 1e18))
+            __testlib_fail("random_t::poisson(double mean): mean must be in range [0, 1e18)");
+        if (mean < 10)
+        {
+            /* Products of uniform values, O(mean) draws. */
+            double limit = std::exp(-mean), product = next();
+            long long result = 0;
+            while (product > limit)
+            {
+                product *= next();
+                result++;
+            }
+            return result;
+        }
+
+        double root = std::sqrt(mean), logMean = std::log(mean);
+        double b = 0.931 + 2.53 * root;
+        double a = -0.059 + 0.02483 * b;
+        double logAlpha = std::log(1.1239 + 1.1328 / (b - 3.4));
+        double vr = 0.9277 - 3.6224 / (b - 2);
+        while (true)
+        {
+            double u = next() - 0.5, v = next();
+            double us = 0.5 - __testlib_abs(u);
+            double k = std::floor((2 * a / us + b) * u + mean + 0.43);
+            if (k < 0)
+                continue;
+            if (us >= 0.07 && v <= vr)
+                return (long long)(k);
+            if (us < 0.013 && v > us)
+                continue;
+            if (std::log(v) + logAlpha - std::log(a / (us * us) + b) <= -mean + k * logMean - __testlib_loggamma(k + 1))
+                return (long long)(k);
+        }
+    }
+};
+
+const int random_t::lim = 25;
+const size_t random_t::FILL_BLOCK_SIZE;
+const unsigned long long random_t::multiplier = 0x5DEECE66DLL;
+const unsigned long long random_t::addend = 0xBLL;
+const unsigned long long random_t::mask = (1LL << 48) - 1;
+int random_t::version = -1;
+random_t::engine_t random_t::engine = random_t::lcg48;
+
+/*
+ * Walker's alias table for a finite weighted distribution, built by
+ * Vose's method in O(n). Use "rnd.next(table)" to get index i with
+ * probability weights[i] / sum(weights) in O(1), it takes a single
+ * random_t::next(long long) call for any number of weights.
+ */
+class alias_table
+{
+public:
+    alias_table()
+    {
     }
 
-    /* Returns weighted random element from container. */
-    template <typename Container>
-    typename Container::value_type wany(const Container& c, int type)
+    template <typename T>
+    alias_table(const std::vector<T>& weights)
     {
-        size_t size = c.size();
-        if (size <= 0)
-            __testlib_fail("random_t::wany(const Container& c, int type): c.size() must be positive");
-        return *(c.begin() + wnext(size, type));
+        int n = int(weights.size());
+        if (n <= 0 || weights.size() > size_t(INT_MAX))
+            __testlib_fail("alias_table::alias_table(const std::vector<T>& weights): weights.size() must be positive and fit int");
+
+        double sum = 0;
+        for (int i = 0; i < n; i++)
+        {
+            if (!(double(weights[i]) >= 0))
+                __testlib_fail("alias_table::alias_table(const std::vector<T>& weights): weights must be non-negative");
+            sum += double(weights[i]);
+        }
+        if (!(sum > 0) || sum > std::numeric_limits<double>::max())
+            __testlib_fail("alias_table::alias_table(const std::vector<T>& weights): sum of weights must be positive and finite");
+
+        std::vector<double> scaled(n);
+        std::vector<int> small, large;
+        for (int i = 0; i < n; i++)
+        {
+            scaled[i] = double(weights[i]) / sum * n;
+            (scaled[i] < 1.0 ? small : large).push_back(i);
+        }
+
+        threshold.assign(n, 1ULL << 32);
+        alias.resize(n);
+        for (int i = 0; i < n; i++)
+            alias[i] = i;
+        while (!small.empty() && !large.empty())
+        {
+            int less = small.back(), more = large.back();
+            small.pop_back();
+            threshold[less] = (unsigned long long)(scaled[less] * 4294967296.0);
+            alias[less] = more;
+            scaled[more] = (scaled[more] + scaled[less]) - 1.0;
+            if (scaled[more] < 1.0)
+            {
+                large.pop_back();
+                small.push_back(more);
+            }
+        }
     }
 
-    /* Returns weighted random element from iterator range. */
-    template <typename Iter>
-    typename Iter::value_type wany(const Iter& begin, const Iter& end, int type)
+    int size() const
     {
-        int size = int(end - begin);
-        if (size <= 0)
-            __testlib_fail("random_t::any(const Iter& begin, const Iter& end, int type): range must have positive length");
-        return *(begin + wnext(size, type));
+        return int(alias.size());
     }
+
+private:
+    /* Column i is taken if the low 32 bits of the draw are less than threshold[i], alias[i] otherwise. */
+    std::vector<unsigned long long> threshold;
+    std::vector<int> alias;
+
+    friend class random_t;
 };
 
-const int random_t::lim = 25;
-const unsigned long long random_t::multiplier = 0x5DEECE66DLL;
-const unsigned long long random_t::addend = 0xBLL;
-const unsigned long long random_t::mask = (1LL << 48) - 1;
-int random_t::version = -1;
+int random_t::next(const alias_table& table)
+{
+    if (table.alias.empty())
+        __testlib_fail("random_t::next(const alias_table& table): table must be non-empty");
+    long long draw = next((long long)(table.alias.size()) << 32);
+    int i = int(draw >> 32);
+    return (unsigned long long)(draw & 0xFFFFFFFFLL) < table.threshold[i] ? i : table.alias[i];
+}
 
 /* Pattern implementation */
 bool pattern::matches(const std::string& s) const
 {
-    return matches(s, 0);
+    return matches(s, 0, 0);
 }
 
 static bool __pattern_isSlash(const std::string& s, size_t pos)
@@ -1014,53 +2307,39 @@ static char __pattern_getChar(const std::string& s, size_t& pos)
     return s[pos - 1];
 }
 
-#ifdef __GNUC__
-__attribute__((pure))
-#endif
-static int __pattern_greedyMatch(const std::string& s, size_t pos, const std::vector<char> chars)
-{
-    int result = 0;
-
-    while (pos < s.length())
-    {
-        char c = s[pos++];
-        if (!std::binary_search(chars.begin(), chars.end(), c))
-            break;
-        else
-            result++;
-    }
-
-    return result;
-}
-
 std::string pattern::src() const
 {
     return s;
 }
 
-bool pattern::matches(const std::string& s, size_t pos) const
+bool pattern::matches(const std::string& s, int pc, size_t pos) const
 {
-    std::string result;
-
-    if (to > 0)
+    while (true)
     {
-        int size = __pattern_greedyMatch(s, pos, chars);
-        if (size < from)
-            return false;
-        if (size > to)
-            size = to;
-        pos += size;
-    }
+        const instruction& in = program[pc];
 
-    if (children.size() > 0)
-    {
-        for (size_t child = 0; child < children.size(); child++)
-            if (children[child].matches(s, pos))
+        if (in.to > 0)
+        {
+            int size = 0;
+            while (pos < s.length() && size < in.to)
+            {
+                unsigned char c = (unsigned char)(s[pos]);
+                if (!((in.mask[c >> 6] >> (c & 63)) & 1))
+                    break;
+                pos++, size++;
+            }
+            if (size < in.from)
+                return false;
+        }
+
+        if (in.first == in.last)
+            return pos == s.length();
+
+        for (int branch = in.first; branch + 1 < in.last; branch++)
+            if (matches(s, branches[branch], pos))
                 return true;
-        return false;
+        pc = branches[in.last - 1];
     }
-    else
-        return pos == s.length();
 }
 
 std::string pattern::next(random_t& rnd) const
@@ -1068,23 +2347,41 @@ std::string pattern::next(random_t& rnd) const
     std::string result;
     result.reserve(20);
 
-    if (to == INT_MAX)
-        __testlib_fail("pattern::next(random_t& rnd): can't process character '*' for generation");
-
-    if (to > 0)
+    int pc = 0;
+    while (true)
     {
-        int count = rnd.next(to - from + 1) + from;
-        for (int i = 0; i < count; i++)
-            result += chars[rnd.next(int(chars.size()))];
-    }
+        const instruction& in = program[pc];
 
-    if (children.size() > 0)
-    {
-        int child = rnd.next(int(children.size()));
-        result += children[child].next(rnd);
-    }
+        if (in.to == INT_MAX)
+            __testlib_fail("pattern::next(random_t& rnd): can't process character '*' for generation");
 
-    return result;
+        if (in.to > 0)
+        {
+            int count = rnd.next(in.to - in.from + 1) + in.from;
+            int size = int(in.chars.size());
+            if (random_t::version >= 3)
+            {
+                /* Since version 3 fill gives the same values as consecutive next(size) calls. */
+                int buffer[256];
+                for (int done = 0; done < count; done += 256)
+                {
+                    int block = std::min(count - done, 256);
+                    rnd.fill(buffer, buffer + block, size);
+                    for (int i = 0; i < block; i++)
+                        result += in.chars[buffer[i]];
+                }
+            }
+            else
+            {
+                for (int i = 0; i < count; i++)
+                    result += in.chars[rnd.next(size)];
+            }
+        }
+
+        if (in.first == in.last)
+            return result;
+        pc = branches[in.first + rnd.next(in.last - in.first)];
+    }
 }
 
 static void __pattern_scanCounts(const std::string& s, size_t& pos, int& from, int& to)
@@ -1239,8 +2536,19 @@ static std::vector<char> __pattern_scanCharSet(const std::string& s, size_t& pos
     return result;
 }
 
-pattern::pattern(std::string s): s(s), from(0), to(0)
+pattern::pattern(std::string s): s(s)
+{
+    compile(s);
+}
+
+int pattern::compile(std::string s)
 {
+    int pc = int(program.size());
+    program.push_back(instruction());
+    std::vector<char> chars;
+    int from = 0, to = 0;
+    std::vector<int> children;
+
     std::string t;
     for (size_t i = 0; i < s.length(); i++)
         if (!__pattern_isCommandChar(s, i, ' '))
@@ -1280,7 +2588,7 @@ pattern::pattern(std::string s): s(s), from(0), to(0)
     if (seps.size() == 0 && firstClose + 1 == (int)s.length() 
             && __pattern_isCommandChar(s, 0, '(') && __pattern_isCommandChar(s, s.length() - 1, ')'))
     {
-        children.push_back(pattern(s.substr(1, s.length() - 2)));
+        children.push_back(compile(s.substr(1, s.length() - 2)));
     }
     else
     {
@@ -1291,7 +2599,7 @@ pattern::pattern(std::string s): s(s), from(0), to(0)
 
             for (size_t i = 0; i < seps.size(); i++)
             {
-                children.push_back(pattern(s.substr(last, seps[i] - last)));
+                children.push_back(compile(s.substr(last, seps[i] - last)));
                 last = seps[i] + 1;
             }
         }
@@ -1301,9 +2609,46 @@ pattern::pattern(std::string s): s(s), from(0), to(0)
             chars = __pattern_scanCharSet(s, pos);
             __pattern_scanCounts(s, pos, from, to);
             if (pos < s.length())
-                children.push_back(pattern(s.substr(pos)));
+                children.push_back(compile(s.substr(pos)));
         }
     }
+
+    instruction& in = program[pc];
+    std::fill(in.mask, in.mask + 4, 0ULL);
+    for (size_t i = 0; i < chars.size(); i++)
+    {
+        unsigned char c = (unsigned char)(chars[i]);
+        in.mask[c >> 6] |= 1ULL << (c & 63);
+    }
+    in.chars = chars;
+    in.from = from;
+    in.to = to;
+    in.first = int(branches.size());
+    branches.insert(branches.end(), children.begin(), children.end());
+    in.last = int(branches.size());
+    return pc;
+}
+
+/*
+ * Patterns are compiled once per source string, so rnd.next("[a-z]{1,5}") or
+ * inf.readToken("[a-z]{1,5}") in a loop doesn't parse the pattern again and again.
+ * The cache is per thread and is dropped if it grows too large, the returned
+ * reference is valid until the next call.
+ */
+static const pattern& __testlib_compiledPattern(const std::string& ptrn)
+{
+    static const size_t MAX_CACHED_PATTERNS = 1024;
+#ifdef __TESTLIB_CPP11
+    thread_local std::map<std::string, pattern> cache;
+#else
+    static std::map<std::string, pattern> cache;
+#endif
+    std::map<std::string, pattern>::iterator i = cache.find(ptrn);
+    if (i != cache.end())
+        return i->second;
+    if (cache.size() >= MAX_CACHED_PATTERNS)
+        cache.clear();
+    return cache.insert(std::make_pair(ptrn, pattern(ptrn))).first->second;
 }
 /* End of pattern implementation */
 
@@ -1650,6 +2995,131 @@ public:
 const size_t BufferedFileInputStreamReader::BUFFER_SIZE = 2000000;
 const size_t BufferedFileInputStreamReader::MAX_UNREAD_COUNT = BufferedFileInputStreamReader::BUFFER_SIZE / 2; 
 
+/*
+ * Reader over the whole file mapped into memory, used for large regular files.
+ * Positions after the end of the data are EOF, so EOF can be read and unread
+ * as any other character. InStream scans tokens right over data().
+ */
+class MmapInputStreamReader: public InputStreamReader
+{
+private:
+    std::FILE* file;
+    char* mapped;
+    size_t size;
+    size_t pos;
+
+    std::string name;
+
+public:
+    /* Files smaller than it are read by BufferedFileInputStreamReader. */
+    static const long long MIN_SIZE;
+
+    /* Returns NULL if the file can't be mapped, the file isn't changed in this case. */
+    static MmapInputStreamReader* open(std::FILE* file, const std::string& name)
+    {
+#ifdef __TESTLIB_MMAP
+        int fd = fileno(file);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+            return NULL;
+        if ((long long)(info.st_size) < MIN_SIZE || (unsigned long long)(info.st_size) > (unsigned long long)(size_t(-1)))
+            return NULL;
+        if (ftell(file) != 0 || lseek(fd, 0, SEEK_CUR) != 0)
+            return NULL;
+        void* mapped = mmap(NULL, size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+            return NULL;
+#ifdef MADV_SEQUENTIAL
+        madvise(mapped, size_t(info.st_size), MADV_SEQUENTIAL);
+#endif
+        return new MmapInputStreamReader(file, name, (char*)(mapped), size_t(info.st_size));
+#else
+        (void)(file), (void)(name);
+        return NULL;
+#endif
+    }
+
+    MmapInputStreamReader(std::FILE* file, const std::string& name, char* mapped, size_t size)
+        : file(file), mapped(mapped), size(size), pos(0), name(name)
+    {
+        // No operations.
+    }
+
+    ~MmapInputStreamReader()
+    {
+        close();
+    }
+
+    /* Mapped bytes, the current position is position(). */
+    const char* data() const
+    {
+        return mapped;
+    }
+
+    size_t length() const
+    {
+        return size;
+    }
+
+    size_t& position()
+    {
+        return pos;
+    }
+
+    int curChar()
+    {
+        return pos < size ? mapped[pos] : EOFC;
+    }
+
+    int nextChar()
+    {
+        return pos < size ? mapped[pos++] : (pos++, EOFC);
+    }
+
+    void skipChar()
+    {
+        pos++;
+    }
+
+    void unreadChar(int c)
+    {
+        if (pos == 0)
+            __testlib_fail("MmapInputStreamReader::unreadChar(int): pos == 0");
+        pos--;
+        if (pos < size && mapped[pos] != char(c))
+            mapped[pos] = char(c);
+    }
+
+    std::string getName()
+    {
+        return name;
+    }
+
+    bool eof()
+    {
+        return pos >= size;
+    }
+
+    void close()
+    {
+#ifdef __TESTLIB_MMAP
+        if (NULL != mapped)
+        {
+            munmap(mapped, size);
+            mapped = NULL;
+            size = pos = 0;
+        }
+#endif
+        if (NULL != file)
+        {
+            fclose(file);
+            file = NULL;
+        }
+    }
+};
+
+const long long MmapInputStreamReader::MIN_SIZE = 1 << 20;
+
 /*
  * Streams to be used for reading data in checkers or validators.
  * Each read*() method moves pointer to the next character after the
@@ -1665,6 +3135,8 @@ struct InStream
     InStream(const InStream& baseStream, std::string content);
 
     InputStreamReader* reader;
+    /* The same as reader if the file is mapped into memory, NULL otherwise. */
+    MmapInputStreamReader* mapped;
 
     std::string name;
     TMode mode;
@@ -1765,6 +3237,22 @@ struct InStream
     /* As "readInt()" but ensures that value in the range [minv,maxv]. */
     int readInt(int minv, int maxv, const std::string& variableName = "");
 
+    /*
+     * Reads "size" integers, separated by single spaces in the strict mode.
+     * Bounds hits are recorded once for all of them as "variablesName".
+     * If the file is mapped into memory, integers are parsed right over the mapped bytes.
+     */
+    std::vector<int> readInts(int size, int minv, int maxv, const std::string& variablesName = "");
+    std::vector<int> readInts(int size);
+    /* As "readInts()" but reads int64 values. */
+    std::vector<long long> readLongs(int size, long long minv, long long maxv, const std::string& variablesName = "");
+    std::vector<long long> readLongs(int size);
+
+    /* Do not use them. */
+    template <typename T>
+    void readMany(std::vector<T>& result, long long minv, long long maxv, const std::string& variablesName);
+    bool readMappedLong(long long& value, long long minv, long long maxv);
+
     /* 
      * Reads new double. Ignores white-spaces into the non-strict mode 
      * (strict mode is used in validators usually). 
@@ -2100,6 +3588,7 @@ static std::string toString(const T& t)
 InStream::InStream()
 {
     reader = NULL;
+    mapped = NULL;
     name = "";
     mode = _input;
     strict = false;
@@ -2110,6 +3599,7 @@ InStream::InStream()
 InStream::InStream(const InStream& baseStream, std::string content)
 {
     reader = new StringInputStreamReader(content);
+    mapped = NULL;
     opened = true;
     strict = baseStream.strict;
     mode = baseStream.mode;
@@ -2123,6 +3613,7 @@ InStream::~InStream()
         reader->close();
         delete reader;
         reader = NULL;
+        mapped = NULL;
     }
 }
 
@@ -2408,7 +3899,11 @@ void InStream::reset(std::FILE* file)
 
         __testlib_set_binary(file);
 
-        if (stdfile)
+        /* Standard input may be interactive, it is mapped only if redirected from a regular file. */
+        mapped = MmapInputStreamReader::open(file, name);
+        if (NULL != mapped)
+            reader = mapped;
+        else if (stdfile)
             reader = new FileInputStreamReader(file, name);
         else
             reader = new BufferedFileInputStreamReader(file, name);
@@ -2417,6 +3912,7 @@ void InStream::reset(std::FILE* file)
     {
         opened = false;
         reader = NULL;
+        mapped = NULL;
     }
 }
 
@@ -2452,11 +3948,15 @@ void InStream::init(std::FILE* f, TMode mode)
 
 char InStream::curChar()
 {
+    if (NULL != mapped)
+        return char(mapped->MmapInputStreamReader::curChar());
     return char(reader->curChar());
 }
 
 char InStream::nextChar()
 {
+    if (NULL != mapped)
+        return char(mapped->MmapInputStreamReader::nextChar());
     return char(reader->nextChar());
 }
 
@@ -2495,6 +3995,16 @@ void InStream::skipChar()
 
 void InStream::skipBlanks()
 {
+    if (NULL != mapped)
+    {
+        const char* data = mapped->data();
+        size_t& pos = mapped->position();
+        size_t length = mapped->length();
+        while (pos < length && isBlanks(data[pos]))
+            pos++;
+        return;
+    }
+
     while (isBlanks(reader->curChar()))
         reader->skipChar();
 }
@@ -2510,6 +4020,25 @@ void InStream::readWordTo(std::string& result)
     if (!strict)
         skipBlanks();
 
+    if (NULL != mapped)
+    {
+        const char* data = mapped->data();
+        size_t& pos = mapped->position();
+        size_t length = mapped->length();
+
+        if (pos >= length)
+            quit(_unexpected_eof, "Unexpected end of file - token expected");
+
+        if (isBlanks(data[pos]))
+            quit(_pe, "Unexpected white-space - token expected");
+
+        size_t start = pos;
+        while (pos < length && !isBlanks(data[pos]))
+            pos++;
+        result.assign(data + start, pos - start);
+        return;
+    }
+
     int cur = reader->nextChar();
 
     if (cur == EOFC)
@@ -2565,7 +4094,7 @@ std::string InStream::readWord(const pattern& p, const std::string& variableName
 
 std::string InStream::readWord(const std::string& ptrn, const std::string& variableName)
 {
-    return readWord(pattern(ptrn), variableName);
+    return readWord(__testlib_compiledPattern(ptrn), variableName);
 }
 
 std::string InStream::readToken(const pattern& p, const std::string& variableName)
@@ -2592,7 +4121,7 @@ void InStream::readWordTo(std::string& result, const pattern& p, const std::stri
 
 void InStream::readWordTo(std::string& result, const std::string& ptrn, const std::string& variableName)
 {
-    return readWordTo(result, pattern(ptrn), variableName);
+    return readWordTo(result, __testlib_compiledPattern(ptrn), variableName);
 }
 
 void InStream::readTokenTo(std::string& result, const pattern& p, const std::string& variableName)
@@ -2925,58 +4454,173 @@ long long InStream::readLong(long long minv, long long maxv, const std::string&
     if (strict && !variableName.empty())
         validator.addBoundsHit(variableName, ValidatorBoundsHit(minv == result, maxv == result));
 
-    return result;
+    return result;
+}
+
+unsigned long long InStream::readUnsignedLong(unsigned long long minv, unsigned long long maxv, const std::string& variableName)
+{
+    unsigned long long result = readUnsignedLong();
+
+    if (result < minv || result > maxv)
+    {
+        if (variableName.empty())
+            quit(_wa, ("Integer " + vtos(result) + " violates the range [" + vtos(minv) + ", " + vtos(maxv) + "]").c_str());
+        else
+            quit(_wa, ("Integer parameter [name=" + variableName + "] equals to " + vtos(result) + ", violates the range [" + vtos(minv) + ", " + vtos(maxv) + "]").c_str());
+    }
+
+    if (strict && !variableName.empty())
+        validator.addBoundsHit(variableName, ValidatorBoundsHit(minv == result, maxv == result));
+
+    return result;
+}
+
+unsigned long long InStream::readLong(unsigned long long minv, unsigned long long maxv, const std::string& variableName)
+{
+    return readUnsignedLong(minv, maxv, variableName);
+}
+
+int InStream::readInt()
+{
+    return readInteger();
+}
+
+int InStream::readInt(int minv, int maxv, const std::string& variableName)
+{
+    int result = readInt();
+
+    if (result < minv || result > maxv)
+    {
+        if (variableName.empty())
+            quit(_wa, ("Integer " + vtos(result) + " violates the range [" + vtos(minv) + ", " + vtos(maxv) + "]").c_str());
+        else
+            quit(_wa, ("Integer parameter [name=" + std::string(variableName) + "] equals to " + vtos(result) + ", violates the range [" + vtos(minv) + ", " + vtos(maxv) + "]").c_str());
+    }
+
+    if (strict && !variableName.empty())
+        validator.addBoundsHit(variableName, ValidatorBoundsHit(minv == result, maxv == result));
+
+    return result;
+}
+
+int InStream::readInteger(int minv, int maxv, const std::string& variableName)
+{
+    return readInt(minv, maxv, variableName);
+}
+
+/*
+ * Parses a plain integer of at most 18 digits, which is followed by a white-space or EOF
+ * and fits [minv,maxv]. Returns false and doesn't move the stream pointer otherwise,
+ * readInt()/readLong() are used to report an error or to read unusual tokens.
+ */
+bool InStream::readMappedLong(long long& value, long long minv, long long maxv)
+{
+    const char* data = mapped->data();
+    size_t length = mapped->length();
+    size_t pos = mapped->position();
+
+    if (!strict)
+        while (pos < length && isBlanks(data[pos]))
+            pos++;
+
+    bool minus = pos < length && data[pos] == '-';
+    size_t start = pos + (minus ? 1 : 0);
+    size_t end = start;
+    long long magnitude = 0;
+
+    while (end < length && end - start < 19 && data[end] >= '0' && data[end] <= '9')
+        magnitude = magnitude * 10 + (data[end++] - '0');
+
+    if (end == start || end - start == 19 || (end < length && !isBlanks(data[end])))
+        return false;
+    if (data[start] == '0' && (end - start > 1 || minus))
+        return false;
+
+    value = minus ? -magnitude : magnitude;
+    if (value < minv || value > maxv)
+        return false;
+
+    mapped->position() = end;
+    return true;
 }
 
-unsigned long long InStream::readUnsignedLong(unsigned long long minv, unsigned long long maxv, const std::string& variableName)
+template <typename T>
+void InStream::readMany(std::vector<T>& result, long long minv, long long maxv, const std::string& variablesName)
 {
-    unsigned long long result = readUnsignedLong();
+    long long minType = (long long)(std::numeric_limits<T>::min());
+    long long maxType = (long long)(std::numeric_limits<T>::max());
+    bool minHit = false;
+    bool maxHit = false;
 
-    if (result < minv || result > maxv)
+    for (size_t i = 0; i < result.size(); i++)
     {
-        if (variableName.empty())
-            quit(_wa, ("Integer " + vtos(result) + " violates the range [" + vtos(minv) + ", " + vtos(maxv) + "]").c_str());
-        else
-            quit(_wa, ("Integer parameter [name=" + variableName + "] equals to " + vtos(result) + ", violates the range [" + vtos(minv) + ", " + vtos(maxv) + "]").c_str());
-    }
+        if (strict && i > 0)
+        {
+            if (NULL != mapped && mapped->curChar() == SPACE)
+                mapped->skipChar();
+            else
+                readSpace();
+        }
 
-    if (strict && !variableName.empty())
-        validator.addBoundsHit(variableName, ValidatorBoundsHit(minv == result, maxv == result));
+        long long value;
+        if (NULL == mapped || !readMappedLong(value, __testlib_max(minv, minType), __testlib_min(maxv, maxType)))
+            value = (sizeof(T) < sizeof(long long) ? readInt() : readLong());
 
-    return result;
-}
+        if (value < minv || value > maxv)
+        {
+            if (variablesName.empty())
+                quit(_wa, ("Integer " + vtos(value) + " violates the range [" + vtos(minv) + ", " + vtos(maxv) + "]").c_str());
+            else
+                quit(_wa, ("Integer parameter [name=" + variablesName + "[" + vtos(i) + "]] equals to " + vtos(value) + ", violates the range [" + vtos(minv) + ", " + vtos(maxv) + "]").c_str());
+        }
 
-unsigned long long InStream::readLong(unsigned long long minv, unsigned long long maxv, const std::string& variableName)
-{
-    return readUnsignedLong(minv, maxv, variableName);
+        minHit = minHit || value == minv;
+        maxHit = maxHit || value == maxv;
+        result[i] = T(value);
+    }
+
+    if (strict && !variablesName.empty())
+        validator.addBoundsHit(variablesName, ValidatorBoundsHit(minHit, maxHit));
 }
 
-int InStream::readInt()
+std::vector<int> InStream::readInts(int size, int minv, int maxv, const std::string& variablesName)
 {
-    return readInteger();
+    if (size < 0)
+        quit(_fail, "readInts: size should be non-negative");
+
+    std::vector<int> result(size);
+    readMany(result, minv, maxv, variablesName);
+    return result;
 }
 
-int InStream::readInt(int minv, int maxv, const std::string& variableName)
+std::vector<int> InStream::readInts(int size)
 {
-    int result = readInt();
+    if (size < 0)
+        quit(_fail, "readInts: size should be non-negative");
 
-    if (result < minv || result > maxv)
-    {
-        if (variableName.empty())
-            quit(_wa, ("Integer " + vtos(result) + " violates the range [" + vtos(minv) + ", " + vtos(maxv) + "]").c_str());
-        else
-            quit(_wa, ("Integer parameter [name=" + std::string(variableName) + "] equals to " + vtos(result) + ", violates the range [" + vtos(minv) + ", " + vtos(maxv) + "]").c_str());
-    }
+    std::vector<int> result(size);
+    readMany(result, INT_MIN, INT_MAX, "");
+    return result;
+}
 
-    if (strict && !variableName.empty())
-        validator.addBoundsHit(variableName, ValidatorBoundsHit(minv == result, maxv == result));
+std::vector<long long> InStream::readLongs(int size, long long minv, long long maxv, const std::string& variablesName)
+{
+    if (size < 0)
+        quit(_fail, "readLongs: size should be non-negative");
 
+    std::vector<long long> result(size);
+    readMany(result, minv, maxv, variablesName);
     return result;
 }
 
-int InStream::readInteger(int minv, int maxv, const std::string& variableName)
+std::vector<long long> InStream::readLongs(int size)
 {
-    return readInt(minv, maxv, variableName);
+    if (size < 0)
+        quit(_fail, "readLongs: size should be non-negative");
+
+    std::vector<long long> result(size);
+    readMany(result, LLONG_MIN, LLONG_MAX, "");
+    return result;
 }
 
 double InStream::readReal()
@@ -3175,6 +4819,17 @@ void InStream::readStringTo(std::string& result)
     result.clear();
     int cur;
 
+    if (NULL != mapped)
+    {
+        const char* data = mapped->data();
+        size_t& pos = mapped->position();
+        size_t length = mapped->length();
+        size_t start = pos;
+        while (pos < length && !isEoln(data[pos]))
+            pos++;
+        result.assign(data + start, pos - start);
+    }
+
     for (;;)
     {
         cur = reader->curChar();
@@ -3214,7 +4869,7 @@ void InStream::readStringTo(std::string& result, const pattern& p, const std::st
 
 void InStream::readStringTo(std::string& result, const std::string& ptrn, const std::string& variableName)
 {
-    readStringTo(result, pattern(ptrn), variableName);
+    readStringTo(result, __testlib_compiledPattern(ptrn), variableName);
 }
 
 std::string InStream::readString(const pattern& p, const std::string& variableName)
@@ -3266,6 +4921,7 @@ void InStream::close()
         reader->close();
         delete reader;
         reader = NULL;
+        mapped = NULL;
     }
     
     opened = false;
@@ -3403,11 +5059,14 @@ static void __testlib_ensuresPreconditions()
         quit(_fail, "Function __testlib_isNaN is not working correctly: possible reason is '-ffast-math'");
 }
 
-void registerGen(int argc, char* argv[], int randomGeneratorVersion)
+void registerGen(int argc, char* argv[], int randomGeneratorVersion, random_t::engine_t randomGeneratorEngine)
 {
-    if (randomGeneratorVersion < 0 || randomGeneratorVersion > 1)
-        quitf(_fail, "Random generator version is expected to be 0 or 1.");
+    if (randomGeneratorVersion < 0 || randomGeneratorVersion > 4)
+        quitf(_fail, "Random generator version is expected to be in range [0, 4].");
+    if ((randomGeneratorVersion < 2) != (randomGeneratorEngine == random_t::lcg48))
+        quitf(_fail, "Random generator versions 0 and 1 use lcg48 engine, it can't be used since version 2.");
     random_t::version = randomGeneratorVersion;
+    random_t::engine = randomGeneratorEngine;
 
     __testlib_ensuresPreconditions();
 
@@ -3416,6 +5075,12 @@ void registerGen(int argc, char* argv[], int randomGeneratorVersion)
     rnd.setSeed(argc, argv);
 }
 
+void registerGen(int argc, char* argv[], int randomGeneratorVersion)
+{
+    registerGen(argc, argv, randomGeneratorVersion,
+            randomGeneratorVersion < 2 ? random_t::lcg48 : random_t::xoshiro256ss);
+}
+
 #ifdef USE_RND_AS_BEFORE_087
 void registerGen(int argc, char* argv[])
 {
@@ -3683,6 +5348,241 @@ void shuffle(_RandomAccessIter __first, _RandomAccessIter __last)
         std::iter_swap(__i, __first + rnd.next(int(__i - __first) + 1));
 }
 
+/*
+ * Rearranges elements such that [first, middle) is a uniformly random
+ * arrangement of middle - first elements of the range, O(middle - first) time.
+ * The order of [middle, last) is unspecified.
+ *
+ * Before version 2 it is the same as shuffle(first, last).
+ */
+template<typename _RandomAccessIter>
+void partial_shuffle(_RandomAccessIter __first, _RandomAccessIter __middle, _RandomAccessIter __last)
+{
+    if (random_t::version < 2)
+    {
+        shuffle(__first, __last);
+        return;
+    }
+    long long __n = (long long)(__last - __first);
+    for (_RandomAccessIter __i = __first; __i != __middle; ++__i)
+        std::iter_swap(__i, __i + rnd.next(__n - (long long)(__i - __first)));
+}
+
+
+#ifdef __TESTLIB_CPP11
+/*
+ * Calls f(i) for each i in [0, count) using all hardware threads. The order
+ * of the calls is unspecified, so the result must not depend on it. Runs
+ * serially if threads are not supported or can't be created (e.g. glibc
+ * before 2.34 without -pthread).
+ */
+template<typename _Function>
+void __testlib_parallel_for(size_t count, _Function f)
+{
+#ifdef __TESTLIB_THREADS
+    size_t threadCount = __testlib_min(__testlib_max(size_t(std::thread::hardware_concurrency()), size_t(1)), count);
+#else
+    size_t threadCount = 1;
+#endif
+    if (threadCount <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            f(i);
+        return;
+    }
+
+#ifdef __TESTLIB_THREADS
+    std::atomic<size_t> nextIndex(0);
+    auto worker = [&]() {
+        for (size_t i = nextIndex++; i < count; i = nextIndex++)
+            f(i);
+    };
+    /* Indices are taken dynamically, so fewer threads than planned are fine. */
+    std::vector<std::thread> threads;
+    try
+    {
+        for (size_t t = 1; t < threadCount; t++)
+            threads.push_back(std::thread(worker));
+    }
+    catch (const std::system_error&)
+    {
+    }
+    worker();
+    for (size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+#endif
+}
+
+const size_t __TESTLIB_SHUFFLE_BUCKET_SIZE = 1 << 16;
+const size_t __TESTLIB_SHUFFLE_MAX_CHUNKS = 256;
+
+/* Calls f(index, bucket) for each index in [begin, end), buckets are drawn from the given stream. */
+template<typename _Function>
+void __testlib_shuffle_forEachBucket(random_t r, size_t begin, size_t end, int bucketCount, _Function f)
+{
+    int buckets[1024];
+    for (size_t i = begin; i < end; i += 1024)
+    {
+        size_t count = __testlib_min(end - i, size_t(1024));
+        r.fill(buckets, buckets + count, bucketCount);
+        for (size_t k = 0; k < count; k++)
+            f(i + k, buckets[k]);
+    }
+}
+
+struct __testlib_shuffle_noop
+{
+    template<typename _Value>
+    void operator()(size_t, _Value&) const
+    {
+    }
+};
+
+/*
+ * Bucket passes of shuffle_parallel. scatter(index, position) moves the element
+ * from index to position of the buffer, each chunk calls its own copy of it in
+ * increasing order of indices. finish(start, size, r) moves the bucket back and
+ * shuffles it using its stream r.
+ */
+template<typename _Scatter, typename _Finish>
+void __testlib_shuffle_buckets(size_t n, _Scatter scatter, _Finish finish)
+{
+    random_t base = rnd.split();
+    const size_t bucketCount = (n + __TESTLIB_SHUFFLE_BUCKET_SIZE - 1) / __TESTLIB_SHUFFLE_BUCKET_SIZE;
+    const size_t chunkCount = __testlib_min(bucketCount, __TESTLIB_SHUFFLE_MAX_CHUNKS);
+    const size_t chunkSize = (n + chunkCount - 1) / chunkCount;
+
+    std::vector<size_t> offsets(chunkCount * bucketCount);
+    __testlib_parallel_for(chunkCount, [&](size_t chunk) {
+        size_t* counts = &offsets[chunk * bucketCount];
+        __testlib_shuffle_forEachBucket(base.stream(chunk), chunk * chunkSize,
+                __testlib_min(n, (chunk + 1) * chunkSize), int(bucketCount),
+                [&](size_t, int bucket) { counts[bucket]++; });
+    });
+
+    std::vector<size_t> bucketStarts(bucketCount + 1);
+    size_t total = 0;
+    for (size_t bucket = 0; bucket < bucketCount; bucket++)
+    {
+        bucketStarts[bucket] = total;
+        for (size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            size_t count = offsets[chunk * bucketCount + bucket];
+            offsets[chunk * bucketCount + bucket] = total;
+            total += count;
+        }
+    }
+    bucketStarts[bucketCount] = total;
+
+    __testlib_parallel_for(chunkCount, [&](size_t chunk) {
+        size_t* positions = &offsets[chunk * bucketCount];
+        _Scatter s = scatter;
+        __testlib_shuffle_forEachBucket(base.stream(chunk), chunk * chunkSize,
+                __testlib_min(n, (chunk + 1) * chunkSize), int(bucketCount),
+                [&](size_t index, int bucket) { s(index, positions[bucket]++); });
+    });
+
+    __testlib_parallel_for(bucketCount, [&](size_t bucket) {
+        random_t r = base.stream(chunkCount + bucket);
+        size_t start = bucketStarts[bucket];
+        finish(start, bucketStarts[bucket + 1] - start, r);
+    });
+}
+
+/*
+ * The same as shuffle_parallel(first, last), but also calls f(index, value) for
+ * each element before it is moved, index is the original position of the element.
+ * Each chunk calls its own copy of f in increasing order of indices, so f may
+ * keep a state depending on the index, like a cached block of random bits.
+ */
+template<typename _RandomAccessIter, typename _Function>
+void shuffle_parallel(_RandomAccessIter __first, _RandomAccessIter __last, _Function __f)
+{
+    typedef typename std::iterator_traits<_RandomAccessIter>::value_type _Value;
+
+    const size_t n = size_t(__last - __first);
+    if (random_t::version < 2 || n <= __TESTLIB_SHUFFLE_BUCKET_SIZE)
+    {
+        for (size_t i = 0; i < n; i++)
+            __f(i, *(__first + i));
+        shuffle(__first, __last);
+        return;
+    }
+
+    std::vector<_Value> buffer(n);
+    __testlib_shuffle_buckets(n,
+        [&buffer, __first, __f](size_t index, size_t position) mutable {
+            _Value& value = buffer[position] = *(__first + index);
+            __f(index, value);
+        },
+        [&](size_t start, size_t size, random_t& r) {
+            std::copy(buffer.begin() + start, buffer.begin() + start + size, __first + start);
+            for (size_t i = 1; i < size; i++)
+                std::iter_swap(__first + start + i, __first + start + r.next(int(i) + 1));
+        });
+}
+
+/*
+ * Shuffles [first1, last1) and the range of the same length at first2 by the same
+ * permutation, as a range of pairs stored in two arrays, without packing them.
+ * f(index, a, b) is called for each pair before it is moved, as in
+ * shuffle_parallel(first, last, f). The permutation is the same as for one range.
+ */
+template<typename _RandomAccessIter1, typename _RandomAccessIter2, typename _Function>
+void shuffle_parallel(_RandomAccessIter1 __first1, _RandomAccessIter1 __last1, _RandomAccessIter2 __first2, _Function __f)
+{
+    typedef typename std::iterator_traits<_RandomAccessIter1>::value_type _Value1;
+    typedef typename std::iterator_traits<_RandomAccessIter2>::value_type _Value2;
+
+    const size_t n = size_t(__last1 - __first1);
+    if (random_t::version < 2 || n <= __TESTLIB_SHUFFLE_BUCKET_SIZE)
+    {
+        for (size_t i = 0; i < n; i++)
+            __f(i, *(__first1 + i), *(__first2 + i));
+        for (size_t i = 1; i < n; i++)
+        {
+            size_t j = size_t(rnd.next(int(i) + 1));
+            std::iter_swap(__first1 + i, __first1 + j);
+            std::iter_swap(__first2 + i, __first2 + j);
+        }
+        return;
+    }
+
+    std::vector<_Value1> buffer1(n);
+    std::vector<_Value2> buffer2(n);
+    __testlib_shuffle_buckets(n,
+        [&buffer1, &buffer2, __first1, __first2, __f](size_t index, size_t position) mutable {
+            _Value1& a = buffer1[position] = *(__first1 + index);
+            _Value2& b = buffer2[position] = *(__first2 + index);
+            __f(index, a, b);
+        },
+        [&](size_t start, size_t size, random_t& r) {
+            std::copy(buffer1.begin() + start, buffer1.begin() + start + size, __first1 + start);
+            std::copy(buffer2.begin() + start, buffer2.begin() + start + size, __first2 + start);
+            for (size_t i = 1; i < size; i++)
+            {
+                size_t j = size_t(r.next(int(i) + 1));
+                std::iter_swap(__first1 + start + i, __first1 + start + j);
+                std::iter_swap(__first2 + start + i, __first2 + start + j);
+            }
+        });
+}
+
+/*
+ * Parallel cache-friendly shuffle. Each element is scattered to a random bucket
+ * (small enough to fit into cache), then each bucket is shuffled by Fisher-Yates.
+ * Chunks and buckets use their own streams of rnd.split(), so the result
+ * depends on the seed only, not on the number of threads. Needs a copy of
+ * the range in memory.
+ *
+ * Before version 2 and for small ranges it is the same as shuffle().
+ */
+template<typename _RandomAccessIter>
+void shuffle_parallel(_RandomAccessIter __first, _RandomAccessIter __last)
+{
+    shuffle_parallel(__first, __last, __testlib_shuffle_noop());
+}
+#endif
 
 template<typename _RandomAccessIter>
 #ifdef __GNUC__
@@ -3717,7 +5617,7 @@ int rand() RAND_THROW_STATEMENT
 __attribute__ ((error("Don't use srand(), you should use " 
         "'registerGen(argc, argv, 1);' to initialize generator seed "
         "by hash code of the command line params. The third parameter "
-        "is randomGeneratorVersion (currently the latest is 1).")))
+        "is randomGeneratorVersion (currently the latest is 4).")))
 #endif
 #ifdef _MSC_VER
 #   pragma warning( disable : 4273 )
@@ -3727,7 +5627,7 @@ void srand(unsigned int seed) RAND_THROW_STATEMENT
     quitf(_fail, "Don't use srand(), you should use " 
         "'registerGen(argc, argv, 1);' to initialize generator seed "
         "by hash code of the command line params. The third parameter "
-        "is randomGeneratorVersion (currently the latest is 1) [ignored seed=%d].", seed);
+        "is randomGeneratorVersion (currently the latest is 4) [ignored seed=%d].", seed);
 }
 
 void startTest(int test)
@@ -3792,8 +5692,172 @@ inline std::string trim(const std::string& s)
     return s.substr(left, right - left + 1);
 }
 
+/*
+ * Formatting of join() items without streams, the result is exactly the same as
+ * "std::stringstream() << value" gives. __testlib_joinTraits<T>::kind is one of:
+ *   __TESTLIB_JOIN_STREAM - no fast formatting, std::stringstream is used;
+ *   __TESTLIB_JOIN_APPEND - append(s, value) appends the value to s;
+ *   __TESTLIB_JOIN_BOUNDED - write(out, value) writes at most maxLength chars
+ *     to out and returns the end, so the result can be allocated once.
+ */
+const int __TESTLIB_JOIN_STREAM = 0;
+const int __TESTLIB_JOIN_APPEND = 1;
+const int __TESTLIB_JOIN_BOUNDED = 2;
+
+template <typename T>
+struct __testlib_joinTraits
+{
+    static const int kind = __TESTLIB_JOIN_STREAM;
+};
+
+template <typename T>
+struct __testlib_joinIntegerTraits
+{
+    static const int kind = __TESTLIB_JOIN_BOUNDED;
+    static const size_t maxLength = std::numeric_limits<T>::digits10 + 2;
+
+    static char* write(char* out, T value)
+    {
+#if __cplusplus >= 201703L
+        return std::to_chars(out, out + maxLength, value).ptr;
+#else
+        char buffer[maxLength];
+        char* end = buffer + maxLength;
+        char* begin = end;
+        bool negative = value < T(0);
+        do
+        {
+            int digit = int(value % 10);
+            *--begin = char('0' + (negative ? -digit : digit));
+            value /= 10;
+        } while (value != 0);
+        if (negative)
+            *--begin = '-';
+        std::memcpy(out, begin, size_t(end - begin));
+        return out + (end - begin);
+#endif
+    }
+};
+
+template <> struct __testlib_joinTraits<short>: __testlib_joinIntegerTraits<short> {};
+template <> struct __testlib_joinTraits<unsigned short>: __testlib_joinIntegerTraits<unsigned short> {};
+template <> struct __testlib_joinTraits<int>: __testlib_joinIntegerTraits<int> {};
+template <> struct __testlib_joinTraits<unsigned int>: __testlib_joinIntegerTraits<unsigned int> {};
+template <> struct __testlib_joinTraits<long>: __testlib_joinIntegerTraits<long> {};
+template <> struct __testlib_joinTraits<unsigned long>: __testlib_joinIntegerTraits<unsigned long> {};
+template <> struct __testlib_joinTraits<long long>: __testlib_joinIntegerTraits<long long> {};
+template <> struct __testlib_joinTraits<unsigned long long>: __testlib_joinIntegerTraits<unsigned long long> {};
+
+/* Streams print all the char types as a single char. */
+template <typename T>
+struct __testlib_joinCharTraits
+{
+    static const int kind = __TESTLIB_JOIN_BOUNDED;
+    static const size_t maxLength = 1;
+
+    static char* write(char* out, T value)
+    {
+        *out = char(value);
+        return out + 1;
+    }
+};
+
+template <> struct __testlib_joinTraits<char>: __testlib_joinCharTraits<char> {};
+template <> struct __testlib_joinTraits<signed char>: __testlib_joinCharTraits<signed char> {};
+template <> struct __testlib_joinTraits<unsigned char>: __testlib_joinCharTraits<unsigned char> {};
+
+/* Without std::boolalpha bool is printed as 0 or 1. */
+template <>
+struct __testlib_joinTraits<bool>
+{
+    static const int kind = __TESTLIB_JOIN_BOUNDED;
+    static const size_t maxLength = 1;
+
+    static char* write(char* out, bool value)
+    {
+        *out = value ? '1' : '0';
+        return out + 1;
+    }
+};
+
+/* Streams print floating point values like "%g" with the default precision 6. */
+template <typename T>
+struct __testlib_joinFloatingTraits
+{
+    static const int kind = __TESTLIB_JOIN_APPEND;
+
+    static void append(std::string& s, T value)
+    {
+        char buffer[64];
+        int length = std::snprintf(buffer, sizeof(buffer), "%Lg", (long double)(value));
+        s.append(buffer, size_t(length));
+    }
+};
+
+template <> struct __testlib_joinTraits<float>: __testlib_joinFloatingTraits<float> {};
+template <> struct __testlib_joinTraits<double>: __testlib_joinFloatingTraits<double> {};
+template <> struct __testlib_joinTraits<long double>: __testlib_joinFloatingTraits<long double> {};
+
+template <typename T>
+struct __testlib_joinStringTraits
+{
+    static const int kind = __TESTLIB_JOIN_APPEND;
+
+    static void append(std::string& s, const std::string& value)
+    {
+        s += value;
+    }
+
+    static void append(std::string& s, const char* value)
+    {
+        if (value != NULL)
+            s += value;
+    }
+};
+
+template <> struct __testlib_joinTraits<std::string>: __testlib_joinStringTraits<std::string> {};
+template <> struct __testlib_joinTraits<const char*>: __testlib_joinStringTraits<const char*> {};
+template <> struct __testlib_joinTraits<char*>: __testlib_joinStringTraits<char*> {};
+
+/* Separators which are formatted without streams. */
+template <typename T>
+struct __testlib_joinSeparator
+{
+    static const bool fast = false;
+};
+
+template <>
+struct __testlib_joinSeparator<char>
+{
+    static const bool fast = true;
+    static std::string str(char separator) { return std::string(1, separator); }
+};
+
+template <>
+struct __testlib_joinSeparator<const char*>
+{
+    static const bool fast = true;
+    static std::string str(const char* separator) { return separator != NULL ? separator : ""; }
+};
+
+template <>
+struct __testlib_joinSeparator<char*>: __testlib_joinSeparator<const char*> {};
+
+template <>
+struct __testlib_joinSeparator<std::string>
+{
+    static const bool fast = true;
+    static std::string str(const std::string& separator) { return separator; }
+};
+
+template <int kind>
+struct __testlib_joinTag
+{
+};
+
 template <typename _ForwardIterator, typename _Separator>
-std::string join(_ForwardIterator first, _ForwardIterator last, _Separator separator)
+std::string __testlib_join(_ForwardIterator first, _ForwardIterator last, _Separator separator,
+        __testlib_joinTag<__TESTLIB_JOIN_STREAM>)
 {
     std::stringstream ss;
     bool repeated = false;
@@ -3808,6 +5872,93 @@ std::string join(_ForwardIterator first, _ForwardIterator last, _Separator separ
     return ss.str();
 }
 
+template <typename _ForwardIterator, typename _Separator>
+std::string __testlib_join(_ForwardIterator first, _ForwardIterator last, _Separator separator,
+        __testlib_joinTag<__TESTLIB_JOIN_APPEND>)
+{
+    typedef typename std::iterator_traits<_ForwardIterator>::value_type value_type;
+    std::string sep = __testlib_joinSeparator<_Separator>::str(separator);
+
+    std::string result;
+    bool repeated = false;
+    for (_ForwardIterator i = first; i != last; i++)
+    {
+        if (repeated)
+            result += sep;
+        else
+            repeated = true;
+        __testlib_joinTraits<value_type>::append(result, *i);
+    }
+    return result;
+}
+
+/* Single-pass iterators can't be counted in advance, so the items are appended one by one. */
+template <typename _InputIterator>
+std::string __testlib_joinBounded(_InputIterator first, _InputIterator last, const std::string& sep,
+        std::input_iterator_tag)
+{
+    typedef typename std::iterator_traits<_InputIterator>::value_type value_type;
+    typedef __testlib_joinTraits<value_type> traits;
+
+    std::string result;
+    char buffer[traits::maxLength];
+    bool repeated = false;
+    for (_InputIterator i = first; i != last; i++)
+    {
+        if (repeated)
+            result += sep;
+        else
+            repeated = true;
+        result.append(buffer, traits::write(buffer, *i));
+    }
+    return result;
+}
+
+/* Forward iterators are counted first, so the result is allocated once. */
+template <typename _ForwardIterator>
+std::string __testlib_joinBounded(_ForwardIterator first, _ForwardIterator last, const std::string& sep,
+        std::forward_iterator_tag)
+{
+    typedef typename std::iterator_traits<_ForwardIterator>::value_type value_type;
+    typedef __testlib_joinTraits<value_type> traits;
+
+    size_t count = size_t(std::distance(first, last));
+    if (count == 0)
+        return std::string();
+    std::string result(count * (traits::maxLength + sep.length()), '\0');
+    char* out = &result[0];
+    out = traits::write(out, *first);
+    for (_ForwardIterator i = ++first; i != last; i++)
+    {
+        std::memcpy(out, sep.data(), sep.length());
+        out = traits::write(out + sep.length(), *i);
+    }
+    result.resize(size_t(out - &result[0]));
+    return result;
+}
+
+template <typename _ForwardIterator, typename _Separator>
+std::string __testlib_join(_ForwardIterator first, _ForwardIterator last, _Separator separator,
+        __testlib_joinTag<__TESTLIB_JOIN_BOUNDED>)
+{
+    return __testlib_joinBounded(first, last, __testlib_joinSeparator<_Separator>::str(separator),
+        typename std::iterator_traits<_ForwardIterator>::iterator_category());
+}
+
+/*
+ * Joins the items into a string as "std::stringstream() << item << separator << item ..." does.
+ * Integers, chars, floating point values and strings are formatted without streams if the
+ * separator is a char or a string.
+ */
+template <typename _ForwardIterator, typename _Separator>
+std::string join(_ForwardIterator first, _ForwardIterator last, _Separator separator)
+{
+    typedef typename std::iterator_traits<_ForwardIterator>::value_type value_type;
+    const int kind = __testlib_joinSeparator<_Separator>::fast
+        ? __testlib_joinTraits<value_type>::kind : __TESTLIB_JOIN_STREAM;
+    return __testlib_join(first, last, separator, __testlib_joinTag<kind>());
+}
+
 template <typename _ForwardIterator>
 std::string join(_ForwardIterator first, _ForwardIterator last)
 {
@@ -1,121 +1,255 @@
+#pragma once
+
 #include "testlib.h"
 #include <cmath>
 #include <vector>
-#include <queue>
 #include <functional>
 #include <algorithm>
 
 namespace gen {
 namespace tree {
 
-class Tree {
+// Read-only compressed sparse row adjacency of a `BasicTree`.
+// Neighbors of $u$ are `neighbors[offsets[u]], ..., neighbors[offsets[u + 1] - 1]`, in the order of edges.
+struct Adjacency {
+  std::vector<int> offsets, neighbors;
+
+  int degree(int u) const { return offsets[u + 1] - offsets[u]; }
+  const int* begin(int u) const { return neighbors.data() + offsets[u]; }
+  const int* end(int u) const { return neighbors.data() + offsets[u + 1]; }
+};
+
+// Tree with edges stored as two arrays of endpoints (structure of arrays).
+// `Index` is the type of stored vertex indices, e.g. `BasicTree<uint16_t>` for trees with $n \le 65536$.
+template<typename Index = int>
+class BasicTree {
  public:
-  explicit Tree(int n): n(n) {}
+  explicit BasicTree(int n): n(n), adjacency_valid(false) {
+    ensuref(fits(n), "tree size doesn't fit the index type");
+  }
+
+  // Copy of a tree with another index type.
+  template<typename Other>
+  explicit BasicTree(const BasicTree<Other> &rhs): BasicTree(rhs.size()) {
+    us.assign(rhs.edge_us().begin(), rhs.edge_us().end());
+    vs.assign(rhs.edge_vs().begin(), rhs.edge_vs().end());
+  }
+
+  int size() const { return n; }
+  int edge_count() const { return static_cast<int>(us.size()); }
+  std::pair<int, int> edge(int i) const { return std::make_pair(static_cast<int>(us[i]), static_cast<int>(vs[i])); }
+  // The $i$-th edge is $(edge\_us()[i], edge\_vs()[i])$.
+  const std::vector<Index>& edge_us() const { return us; }
+  const std::vector<Index>& edge_vs() const { return vs; }
+
+  void reserve(int m) {
+    us.reserve(m);
+    vs.reserve(m);
+  }
 
   void add_edge(int u, int v) {
     ensuref(0 <= u && u < n, "index out of bound");
     ensuref(0 <= v && v < n, "index out of bound");
-    edges.emplace_back(u, v);
+    us.push_back(static_cast<Index>(u));
+    vs.push_back(static_cast<Index>(v));
+    adjacency_valid = false;
   }
 
+  // Built on the first call and cached until the tree is changed or `release_adjacency` is called,
+  // which invalidate the reference as well as `add_edge`, `link`, `glue` and `relabel` do.
+  // The first call writes the cache, it must not run concurrently with other calls on the same tree.
+  const Adjacency& adjacency() const {
+    if (!adjacency_valid) {
+      build_adjacency(cached_adjacency);
+      adjacency_valid = true;
+    }
+    return cached_adjacency;
+  }
+
+  // Free the memory of the cached adjacency.
+  void release_adjacency() {
+    cached_adjacency = Adjacency();
+    adjacency_valid = false;
+  }
+
+  // Relabel vertices and swap endpoints of edges randomly, edges are shuffled since version 2.
+  // Since version 2, endpoints are rewritten while edges are moved by `shuffle_parallel`,
+  // and swap bits of 64 consecutive edges are taken from one counter-based random word.
   void relabel() {
-    std::vector<int> label(n);
-    for (int i = 0; i < n; ++i) label[i] = i;
-    shuffle(label.begin(), label.end());
-    for (auto &e: edges) {
-      e.first = label[e.first];
-      e.second = label[e.second];
-      if (rnd.next(2)) std::swap(e.first, e.second);
+    std::vector<Index> label(n);
+    for (int i = 0; i < n; ++i) label[i] = static_cast<Index>(i);
+    shuffle_parallel(label.begin(), label.end());
+    adjacency_valid = false;
+    int m = edge_count();
+    if (random_t::version < 2) {
+      for (int i = 0; i < m; ++i) {
+        us[i] = label[us[i]];
+        vs[i] = label[vs[i]];
+        if (rnd.next(2)) std::swap(us[i], vs[i]);
+      }
+      return;
     }
+    unsigned long long key = rnd.next(std::numeric_limits<long long>::max());
+    unsigned long long block = ~0ULL, bits = 0;
+    shuffle_parallel(us.begin(), us.end(), vs.begin(), [&label, key, block, bits](size_t i, Index &u, Index &v) mutable {
+      if ((i >> 6) != block) {
+        block = i >> 6;
+        bits = random_t::at(key, block);
+      }
+      u = label[u];
+      v = label[v];
+      if (bits >> (i & 63) & 1) std::swap(u, v);
+    });
   }
 
   // Convert an unrooted tree to a rooted tree
   // If `relabel = 1`, the result `parent` array will satisfy: `parent[i] < i`.
   // Otherwise, `parent[root]` will be `-1`.
-  std::vector<int> parents(int root, bool relabel = false) {
+  std::vector<int> parents(int root, bool relabel = false) const {
     ensuref(0 <= root && root < n, "index out of bound");
-    std::vector<int> label(n);
-    std::vector<std::vector<int>> adj(n);
-    for (auto &e: edges) {
-      adj[e.first].push_back(e.second);
-      adj[e.second].push_back(e.first);
-    }
+    // The cache is only read, so concurrent calls on the same tree are safe.
+    Adjacency local;
+    if (!adjacency_valid) build_adjacency(local);
+    const Adjacency &adj = adjacency_valid ? cached_adjacency : local;
 
-    std::vector<int> parent(n, -1);
+    // Preorder DFS with an explicit stack, children are pushed in reverse
+    // so they are visited in the same order as a recursive DFS.
+    std::vector<int> up(n, -1), label(n), stack(1, root);
     int m = 0;
-    std::function<void(int, int)> dfs = [&](int u, int p) {
+    while (!stack.empty()) {
+      int u = stack.back();
+      stack.pop_back();
       label[u] = m++;
-      if (p != -1) {
-        if (relabel) parent[label[u]] = label[p];
-        else parent[u] = p;
-      }
-      for (auto &v: adj[u]) if (v != p) {
-        dfs(v, u);
+      for (const int *it = adj.end(u); it-- != adj.begin(u);) {
+        int v = *it;
+        if (v != up[u]) {
+          up[v] = u;
+          stack.push_back(v);
+        }
       }
-    };
-
-    dfs(root, -1);
+    }
+    if (!relabel) return up;
 
+    std::vector<int> parent(n, -1);
+    for (int u = 0; u < n; ++u) {
+      if (up[u] != -1) parent[label[u]] = label[up[u]];
+    }
     return parent;
   }
 
   // Merge `this` and `rhs` such that vertices `u` and `v` are connected with an extra edge.
-  void link(int u, const Tree &rhs, int v) {
+  void link(int u, const BasicTree &rhs, int v) {
     ensuref(0 <= u && u < n, "index out of bound");
     ensuref(0 <= v && v < rhs.n, "index out of bound");
-    for (auto &e: rhs.edges) {
-      add_edge(n + e.first, n + e.second);
-    }
-    add_edge(u, v + n);
+    ensuref(fits(n + rhs.n), "tree size doesn't fit the index type");
+    int offset = n, m = rhs.edge_count();
     n += rhs.n;
+    reserve(edge_count() + m + 1);
+    for (int i = 0; i < m; ++i) {
+      add_edge(offset + rhs.us[i], offset + rhs.vs[i]);
+    }
+    add_edge(u, v + offset);
   }
 
   // Merge `this` and `rhs` such that vertices `u` and `v` are glued into one.
-  void glue(int u, const Tree &rhs, int v) {
+  void glue(int u, const BasicTree &rhs, int v) {
     ensuref(0 <= u && u < n, "index out of bound");
     ensuref(0 <= v && v < rhs.n, "index out of bound");
-    for (auto &e: rhs.edges) {
-      int a = e.first, b = e.second;
-      if (e.first == v) a = u;
-      else if (e.first > v) a = e.first + n - 1;
-      else a = e.first + n;
-      if (e.second == v) b = u;
-      else if (e.second > v) b = e.second + n - 1;
-      else b = e.second + n;
-      add_edge(a, b);
-    }
+    ensuref(fits(n + rhs.n - 1), "tree size doesn't fit the index type");
+    int offset = n, m = rhs.edge_count();
     n += rhs.n - 1;
+    reserve(edge_count() + m);
+    auto shift = [&](int x) { return x == v ? u : x > v ? x + offset - 1 : x + offset; };
+    for (int i = 0; i < m; ++i) {
+      add_edge(shift(rhs.us[i]), shift(rhs.vs[i]));
+    }
   }
 
-  static Tree from_prufer(const std::vector<int>& a) {
+  // Decode a prufer sequence, the $i$-th edge is $(a_i, \text{smallest leaf})$.
+  // The smallest leaf is tracked by a pointer which only moves forward, a vertex becoming
+  // a leaf behind the pointer is the next one immediately.
+  // Time Complexity: $O(n)$
+  static BasicTree from_prufer(const std::vector<int>& a) {
     int n = a.size() + 2;
-    Tree res(n);
+    BasicTree res(n);
+    res.reserve(n - 1);
     std::vector<int> deg(n, 1);
-    for (auto &x: a) deg[x]++;
-    std::priority_queue<int, std::vector<int>, std::greater<int>> pq;
-    for (int i = 0; i < n; ++i) {
-      if (deg[i] == 1) pq.push(i);
+    for (auto &x: a) {
+      ensuref(0 <= x && x < n, "from_prufer failed: index out of bound");
+      deg[x]++;
     }
-    for (auto &u: a) if (!pq.empty()) {
-      int v = pq.top(); pq.pop();
-      --deg[v]; --deg[u];
-      res.add_edge(u, v);
-      if (deg[u] == 1) pq.push(u);
-    }
-    int u = -1, v = -1;
-    for (int i = 0; i < n && v == -1; ++i) if (deg[i] == 1) {
-      if (u == -1) u = i;
-      else v = i;
+    int ptr = 0;
+    while (deg[ptr] != 1) ++ptr;
+    int leaf = ptr;
+    for (auto &u: a) {
+      res.add_edge(u, leaf);
+      if (--deg[u] == 1 && u < ptr) {
+        leaf = u;
+      } else {
+        while (deg[++ptr] != 1);
+        leaf = ptr;
+      }
     }
-    res.add_edge(u, v);
+    res.add_edge(leaf, n - 1);
     return res;
   }
 
+  // Encode the tree as a prufer sequence, `from_prufer(to_prufer())` has the same edge set.
+  // Time Complexity: $O(n)$
+  std::vector<int> to_prufer() const {
+    ensuref(n >= 2 && edge_count() == n - 1, "to_prufer failed: not a tree with at least 2 vertices");
+    std::vector<int> parent = parents(n - 1), deg(n), a(n - 2);
+    for (int i = 0; i < n - 1; ++i) {
+      deg[us[i]]++;
+      deg[vs[i]]++;
+    }
+    int ptr = 0;
+    while (deg[ptr] != 1) ++ptr;
+    int leaf = ptr;
+    for (int i = 0; i < n - 2; ++i) {
+      int u = parent[leaf];
+      a[i] = u;
+      if (--deg[u] == 1 && u < ptr) {
+        leaf = u;
+      } else {
+        while (deg[++ptr] != 1);
+        leaf = ptr;
+      }
+    }
+    return a;
+  }
+
  private:
+  // Counting sort by endpoint, `offsets[u + 1]` is used as the cursor of $u$.
+  void build_adjacency(Adjacency &adj) const {
+    std::vector<int> &offsets = adj.offsets, &neighbors = adj.neighbors;
+    int m = edge_count();
+    offsets.assign(n + 2, 0);
+    neighbors.resize(m * 2);
+    for (int i = 0; i < m; ++i) {
+      ++offsets[us[i] + 2];
+      ++offsets[vs[i] + 2];
+    }
+    for (int i = 2; i <= n; ++i) offsets[i] += offsets[i - 1];
+    for (int i = 0; i < m; ++i) {
+      neighbors[offsets[us[i] + 1]++] = vs[i];
+      neighbors[offsets[vs[i] + 1]++] = us[i];
+    }
+    offsets.pop_back();
+  }
+
+  static bool fits(long long n) {
+    return n - 1 <= static_cast<long long>(std::numeric_limits<Index>::max());
+  }
+
   int n;
-  std::vector<std::pair<int, int>> edges;
+  std::vector<Index> us, vs;
+  mutable Adjacency cached_adjacency;
+  mutable bool adjacency_valid;
 };
 
+typedef BasicTree<> Tree;
+
 // Generate a random tree with $n$ nodes using prufer sequence.
 Tree random(int n) {
   Tree res(n);
@@ -125,7 +259,21 @@ Tree random(int n) {
     return res;
   }
   std::vector<int> a(n - 2);
-  for (int i = 0; i < n - 2; ++i) a[i] = rnd.next(n);
+  rnd.fill(a, n);
+  return Tree::from_prufer(a);
+}
+
+// Generate a random tree with $n$ nodes using prufer sequence.
+// The $i$-th element of the sequence depends only on `key` and $i$.
+Tree random(int n, unsigned long long key) {
+  Tree res(n);
+  if (n == 1) return res;
+  if (n == 2) {
+    res.add_edge(0, 1);
+    return res;
+  }
+  std::vector<int> a(n - 2);
+  for (int i = 0; i < n - 2; ++i) a[i] = random_t::at(key, i, n);
   return Tree::from_prufer(a);
 }
 
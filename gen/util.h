@@ -1,18 +1,16 @@
 #pragma once
 
 #include "testlib.h"
+#include <type_traits>
 #include <vector>
 
 namespace gen {
 namespace util {
 // Random distribute $n$ undistinguishable item into $T$ different boxes.
 std::vector<int> distribute(int n, int T) {
-  std::vector<int> cuts, result;
-  cuts.push_back(0);
-  for (auto i = 0; i < T - 1; ++ i) {
-    cuts.push_back(rnd.next(0, n - T));
-  }
-  cuts.push_back(n - T);
+  std::vector<int> cuts(T + 1), result;
+  if (T > 1) rnd.fill(cuts.data() + 1, cuts.data() + T, 0, n - T);
+  cuts[T] = n - T;
   std::sort(cuts.begin(), cuts.end());
   for (auto i = 1; i <= T; ++ i) {
     result.push_back(cuts.at(i) - cuts.at(i - 1) + 1);
@@ -20,23 +18,322 @@ std::vector<int> distribute(int n, int T) {
   return result;
 }
 
+namespace detail {
+// Open addressing hash set with linear probing for non-negative keys.
+template<typename Int>
+class flat_hash_set {
+ public:
+  explicit flat_hash_set(size_t expected) {
+    size_t capacity = 16;
+    while (capacity < expected * 2) capacity *= 2;
+    keys.assign(capacity, empty());
+  }
+
+  bool contains(Int key) const { return keys[slot(key)] != empty(); }
+
+  // Returns false if `key` is already present.
+  bool insert(Int key) {
+    size_t i = slot(key);
+    if (keys[i] != empty()) return false;
+    keys[i] = key;
+    return true;
+  }
+
+ protected:
+  size_t slot(Int key) const {
+    size_t mask = keys.size() - 1;
+    size_t i = hash(key) & mask;
+    while (keys[i] != key && keys[i] != empty()) i = (i + 1) & mask;
+    return i;
+  }
+
+  static Int empty() { return static_cast<Int>(-1); }
+  static size_t hash(Int key) {
+    unsigned long long x = static_cast<unsigned long long>(key) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(x ^ (x >> 32));
+  }
+
+  std::vector<Int> keys;
+};
+
+// Open addressing hash map with linear probing for non-negative keys.
+template<typename Int>
+class flat_hash_map : private flat_hash_set<Int> {
+  using flat_hash_set<Int>::keys;
+  using flat_hash_set<Int>::slot;
+  using flat_hash_set<Int>::empty;
+
+ public:
+  explicit flat_hash_map(size_t expected) : flat_hash_set<Int>(expected) {
+    values.resize(keys.size());
+  }
+
+  // Returns the value of `key`, or `init` if it is absent.
+  Int find(Int key, Int init) const {
+    size_t i = slot(key);
+    return keys[i] == empty() ? init : values[i];
+  }
+
+  // Returns the value of `key`, inserts `init` if it is absent.
+  Int& get(Int key, Int init) {
+    size_t i = slot(key);
+    if (keys[i] == empty()) {
+      keys[i] = key;
+      values[i] = init;
+    }
+    return values[i];
+  }
+
+ private:
+  std::vector<Int> values;
+};
+
+}
+
+// Random $k$-permutation of $\{0, 1, \ldots, n - 1\}$: the first $k$ elements of a random permutation.
+// Fisher-Yates shuffle over a virtual array, only touched positions are stored in a hash map.
+// Time Complexity: $O(k)$, works for huge $n$.
+template<typename Int>
+std::vector<Int> random_permutation(Int n, int k) {
+  ensuref(n >= static_cast<Int>(k), "random_permutation failed: n >= k");
+  detail::flat_hash_map<Int> moved(k);
+  std::vector<Int> result(k);
+  for (int i = 0; i < k; ++i) {
+    Int j = rnd.next(static_cast<Int>(i), static_cast<Int>(n - 1));
+    Int& target = moved.get(j, j);
+    result[i] = target;
+    target = moved.find(i, i);
+  }
+  return result;
+}
+
+// Streams a random $k$-subset of $\{0, 1, \ldots, n - 1\}$ in increasing order, one element at a time.
+// Vitter's sequential sampling (Method D, falls back to Method A when $k$ is dense in $n$).
+// Time Complexity: $O(k)$ expected in total, $O(1)$ memory.
+//
+// for (long long x : gen::util::sorted_sampler<long long>(n, k)) { ... }
+template<typename Int>
+class sorted_sampler {
+ public:
+  class iterator {
+   public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef Int value_type;
+    typedef long long difference_type;
+    typedef const Int* pointer;
+    typedef const Int& reference;
+
+    iterator() : sampler(nullptr), value() {}
+    explicit iterator(sorted_sampler* sampler) : sampler(sampler), value() { ++*this; }
+
+    reference operator*() const { return value; }
+    pointer operator->() const { return &value; }
+    iterator& operator++() {
+      if (sampler->empty()) {
+        sampler = nullptr;
+      } else {
+        value = sampler->next();
+      }
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator t = *this;
+      ++*this;
+      return t;
+    }
+    bool operator==(const iterator& other) const { return sampler == other.sampler; }
+    bool operator!=(const iterator& other) const { return sampler != other.sampler; }
+
+   private:
+    sorted_sampler* sampler;
+    Int value;
+  };
+
+  sorted_sampler(Int n, long long k)
+      : n(static_cast<long long>(n)), k(k), current(-1), vprime(1.0), dense(false) {
+    ensuref(k >= 0 && this->n >= k, "sorted_sampler failed: n >= k >= 0");
+    qu1 = this->n - k + 1;
+    threshold = 13.0 * static_cast<double>(k);
+    if (k > 0) vprime = std::exp(std::log(rnd.next()) / static_cast<double>(k));
+  }
+
+  bool empty() const { return k == 0; }
+  // Number of elements not yet yielded.
+  long long remaining() const { return k; }
+
+  // Single pass, `begin` draws the first element.
+  iterator begin() { return iterator(this); }
+  iterator end() { return iterator(); }
+
+  Int next() {
+    ensuref(k > 0, "sorted_sampler failed: no elements left");
+    long long skip;
+    if (k > 1 && !dense && threshold < static_cast<double>(n)) {
+      skip = skipD();
+    } else if (k > 1) {
+      dense = true;
+      skip = skipA();
+    } else {
+      double u = dense ? rnd.next() : vprime;
+      skip = std::min(static_cast<long long>(static_cast<double>(n) * u), n - 1);
+    }
+    n -= skip + 1;
+    qu1 -= skip;
+    threshold -= 13.0;
+    k -= 1;
+    current += skip + 1;
+    return static_cast<Int>(current);
+  }
+
+ private:
+  long long skipD() {
+    double nd = static_cast<double>(n), qu1d = static_cast<double>(qu1);
+    double kinv = 1.0 / static_cast<double>(k), k1inv = 1.0 / static_cast<double>(k - 1);
+    long long skip;
+    while (true) {
+      double x;
+      while (true) {
+        x = nd * (1.0 - vprime);
+        skip = static_cast<long long>(x);
+        if (skip < qu1) break;
+        vprime = std::exp(std::log(rnd.next()) * kinv);
+      }
+      double y1 = std::exp(std::log(rnd.next() * nd / qu1d) * k1inv);
+      vprime = y1 * (1.0 - x / nd) * (qu1d / (qu1d - static_cast<double>(skip)));
+      if (vprime <= 1.0) break;
+      double y2 = 1.0, top = nd - 1.0, bottom;
+      long long limit;
+      if (k - 1 > skip) {
+        bottom = nd - static_cast<double>(k);
+        limit = n - skip;
+      } else {
+        bottom = nd - static_cast<double>(skip) - 1.0;
+        limit = qu1;
+      }
+      for (long long t = n - 1; t >= limit; --t) {
+        y2 = y2 * top / bottom;
+        top -= 1.0;
+        bottom -= 1.0;
+      }
+      if (nd / (nd - x) >= y1 * std::exp(std::log(y2) * k1inv)) {
+        vprime = std::exp(std::log(rnd.next()) * k1inv);
+        break;
+      }
+      vprime = std::exp(std::log(rnd.next()) * kinv);
+    }
+    return skip;
+  }
+
+  long long skipA() {
+    double top = static_cast<double>(n - k), nd = static_cast<double>(n);
+    double v = rnd.next(), quot = top / nd;
+    long long skip = 0;
+    while (quot > v) {
+      ++skip;
+      top -= 1.0;
+      nd -= 1.0;
+      quot = quot * top / nd;
+    }
+    return skip;
+  }
+
+  long long n, k, current, qu1;
+  double threshold, vprime;
+  bool dense;
+};
+
 // Random sample $k$ elements from $n$ elements with equal probability.
-// Time Complexity: $O(k \log k)$
+// Floyd's algorithm, chosen elements are kept in a bitmap if $n \le 32k$ and in a flat hash set otherwise.
+// If `sorted` is false, the elements are returned in unspecified order.
+// Time Complexity: $O(k \log k)$ if sorted, $O(k)$ otherwise.
 template<typename Int>
-std::vector<Int> random_subset(Int n, int k) {
+std::vector<Int> random_subset(Int n, int k, bool sorted = true) {
   ensuref(n >= k, "random_subset failed: n >= k");
-  std::set<Int> set;
-  for (Int i = n - k; i < n; ++ i) {
-    Int p = rnd.next(static_cast<Int>(0), i);
-    if (set.count(p)) {
-      set.insert(i);
-    } else {
-      set.insert(p);
+  std::vector<Int> result;
+  result.reserve(k);
+  if (n / 32 <= static_cast<Int>(k)) {
+    std::vector<bool> chosen(n);
+    for (Int i = n - k; i < n; ++ i) {
+      Int p = rnd.next(static_cast<Int>(0), i);
+      if (chosen[p]) p = i;
+      chosen[p] = true;
+      if (!sorted) result.push_back(p);
     }
+    if (sorted) {
+      for (Int i = 0; i < n; ++ i) {
+        if (chosen[i]) result.push_back(i);
+      }
+    }
+  } else {
+    detail::flat_hash_set<Int> set(k);
+    for (Int i = n - k; i < n; ++ i) {
+      Int p = rnd.next(static_cast<Int>(0), i);
+      if (!set.insert(p)) {
+        set.insert(i);
+        p = i;
+      }
+      result.push_back(p);
+    }
+    if (sorted) std::sort(result.begin(), result.end());
   }
+  return result;
+}
+
+// Random sample $k$ elements from $n$ elements with equal probability, in increasing order.
+// Drains a `sorted_sampler`, draws differ from `random_subset`.
+// Time Complexity: $O(k)$, no memory besides the result.
+template<typename Int>
+std::vector<Int> random_subset_sequential(Int n, int k) {
+  ensuref(n >= k, "random_subset_sequential failed: n >= k");
   std::vector<Int> result;
-  for (auto elem: set) {
-    result.push_back(elem);
+  result.reserve(k);
+  for (Int x : sorted_sampler<Int>(n, k)) result.push_back(x);
+  return result;
+}
+
+// Random distribute $n$ undistinguishable item into $T$ different boxes, each box gets $[lo, hi]$ items.
+// Cut points are drawn already sorted by a `sorted_sampler`, so the result is uniform when $hi$ does not bind.
+// Boxes exceeding $hi$ are clamped and the surplus is distributed again among the others,
+// so once $hi$ binds the composition is no longer uniform.
+// `Int` is deduced from $n$ only, e.g. `distribute(10LL, 3, 0, 5)` gives `std::vector<long long>`.
+// Time Complexity: $O(T)$ per round, works for huge $n$.
+template<typename Int>
+std::vector<Int> distribute(Int n, int T, typename std::common_type<Int>::type lo,
+                            typename std::common_type<Int>::type hi = std::numeric_limits<Int>::max()) {
+  ensuref(T >= 1 && 0 <= lo && lo <= hi, "distribute failed: T >= 1, 0 <= lo <= hi");
+  // Bounds are checked in unsigned arithmetic, so neither unsigned `Int` nor $T \cdot lo$ overflows.
+  const unsigned long long limit = std::numeric_limits<long long>::max();
+  const unsigned long long total = n < 0 ? limit + 1 : static_cast<unsigned long long>(n);
+  const unsigned long long low = static_cast<unsigned long long>(lo);
+  const unsigned long long high = std::min(static_cast<unsigned long long>(hi), limit);
+  ensuref(total <= limit && low <= total / T, "distribute failed: T * lo <= n <= T * hi");
+  long long rest = static_cast<long long>(total - low * T);
+  long long cap = static_cast<long long>(high - low);
+  ensuref(cap >= rest / T + (rest % T != 0), "distribute failed: T * lo <= n <= T * hi");
+  std::vector<Int> result(T, lo);
+  std::vector<int> open(T);
+  for (int i = 0; i < T; ++ i) open[i] = i;
+  while (rest > 0) {
+    int k = static_cast<int>(open.size());
+    long long prev = -1;
+    int j = 0;
+    for (long long cut : sorted_sampler<long long>(rest + k - 1, k - 1)) {
+      result[open[j ++]] += static_cast<Int>(cut - prev - 1);
+      prev = cut;
+    }
+    result[open[k - 1]] += static_cast<Int>(rest + k - 2 - prev);
+    rest = 0;
+    j = 0;
+    for (int i : open) {
+      long long extra = static_cast<long long>(result[i]) - lo;
+      if (extra >= cap) {
+        rest += extra - cap;
+        result[i] = lo + static_cast<Int>(cap);
+      } else {
+        open[j ++] = i;
+      }
+    }
+    open.resize(j);
   }
   return result;
 }